@@ -0,0 +1,625 @@
+#pragma once
+
+// Подмена глобальных operator new/delete со счетчиками выделений памяти.
+//
+// Заголовок определяет заменяемые функции распределения, поэтому его можно подключать
+// только в одну единицу трансляции программы (в этом репозитории программа и есть один .cpp).
+// Счетчики ведутся для каждого потока отдельно и без атомарных операций.
+//
+// Профилировщик выделений включается при компиляции: -DALLOC_PROFILE=1. Тогда дополнительно:
+//   - в среднем каждое N-е выделение (N из переменной окружения ALLOC_PROFILE_RATE,
+//     по умолчанию 1000, 0 - без выборки) запоминает стек вызова; по стекам оцениваются
+//     выделения и не освобожденные байты для каждого места в программе;
+//   - классы с ALLOC_PROFILE_TYPE("Имя") внутри объявления точно считают живые объекты и байты
+//     своего типа (операторы new/delete класса наследуются, потомки указывают свое имя);
+//   - при завершении программы в stderr выводится отчет о том, что осталось не освобождено.
+// Обычные блоки выделяются как раньше, без заголовков: блоки из выборки берутся из отдельной
+// области памяти, и delete узнает их по адресу. Стеки снимаются по цепочке указателей кадров,
+// поэтому собирать нужно с -fno-omit-frame-pointer; без него это обнаруживается при первой выборке,
+// и стеки снимаются по таблицам раскрутки, что примерно в сто раз дороже. Имена функций в стеках
+// видны при сборке с -rdynamic; иначе адреса можно расшифровать addr2line.
+// Без ALLOC_PROFILE макрос ALLOC_PROFILE_TYPE пуст, а new/delete работают как раньше.
+
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+#ifndef ALLOC_PROFILE
+#define ALLOC_PROFILE 0
+#endif
+
+#if ALLOC_PROFILE
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <execinfo.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <unwind.h>
+#endif
+
+namespace alloc_hooks {
+
+struct AllocStats {
+    std::uint64_t allocations = 0; // Вызовов operator new
+    std::uint64_t frees = 0;       // Вызовов operator delete с ненулевым указателем
+    std::uint64_t bytes = 0;       // Запрошено байт
+};
+
+#if ALLOC_PROFILE
+
+namespace profile {
+
+constexpr int kMaxDepth = 16;                   // Кадров в запомненном стеке
+constexpr int kMaxStacks = 4096;                // Разных мест выделения; остальные попадают в последнюю запись
+constexpr int kMaxTypes = 64;
+constexpr int kReportTop = 10;
+constexpr std::size_t kArenaBytes = 1ull << 32; // Резерв адресов под блоки из выборки (страницы выделяются по мере записи)
+constexpr int kArenaClasses = 32;               // Блоки области - степени двойки от 32 байт до 2 ГБ
+
+// Заголовок блока из выборки; 16 байт сохраняют выравнивание malloc
+struct SampledHeader {
+    std::uint64_t size;
+    std::uint32_t stack;     // Номер записи в таблице стеков + 1
+    std::uint32_t sizeClass; // Размер блока области - 2^sizeClass
+};
+
+static_assert(sizeof(SampledHeader) == 16, "Заголовок должен сохранять выравнивание блока");
+
+// Место выделения из выборки
+struct StackEntry {
+    std::uint64_t hash;
+    int depth;
+    void* frames[kMaxDepth];
+    std::uint64_t allocations;
+    std::uint64_t bytes;
+    std::uint64_t liveAllocations;
+    std::uint64_t liveBytes;
+};
+
+// Счетчики одного типа в одном потоке; живые - разность выделенного и освобожденного по всем потокам
+struct TypeCounters {
+    std::uint64_t allocations;
+    std::uint64_t bytes;
+    std::uint64_t frees;
+    std::uint64_t freedBytes;
+};
+
+// Счетчики одного потока. Запись создается при первом выделении или освобождении в потоке
+// и не удаляется: после завершения потока она остается в общем списке, поэтому в отчет попадают
+// и освобождения из деструкторов thread_local, которые выполняются позже любого нашего.
+// Цена - около 2 КБ на каждый когда-либо созданный поток
+struct ThreadRecord {
+    AllocStats stats;
+    std::int64_t sampleCountdown; // Выделений до следующей выборки
+    TypeCounters types[kMaxTypes];
+    ThreadRecord* next;
+};
+
+struct Totals {
+    AllocStats stats;
+    TypeCounters types[kMaxTypes];
+};
+
+// Таблицы - статические массивы: внутри operator new нельзя выделять память через него же.
+// Стеки и область блоков из выборки меняются под sampleLock
+inline StackEntry stacks[kMaxStacks];
+inline int stackCount = 0;
+inline std::atomic<std::uintptr_t> arenaBegin{0 - kArenaBytes}; // До создания области - адреса ядра, куда не попадает ни один блок
+inline char* arenaTop = nullptr;
+inline bool arenaFailed = false;
+inline void* arenaFree[kArenaClasses]; // Свободные блоки по классам; ссылка на следующий - в самом блоке
+inline std::atomic_flag sampleLock = ATOMIC_FLAG_INIT;
+
+inline const char* typeNames[kMaxTypes];
+inline std::atomic<int> typeCount{0};
+inline std::atomic_flag typeLock = ATOMIC_FLAG_INIT;
+
+// Записи всех потоков, новые в начале. Последняя - запасная: в нее пишут потоки,
+// которым не хватило памяти под свою запись (тогда их счетчики могут терять приращения)
+inline ThreadRecord spareRecord;
+inline std::atomic<ThreadRecord*> threadRecords{&spareRecord};
+
+inline thread_local ThreadRecord* threadRecord = nullptr;
+inline thread_local bool sampling = false;
+inline thread_local std::uintptr_t stackEnd = 0; // Верхняя граница стека потока для прохода по кадрам
+
+// Как снимаются стеки; выбирается при первой выборке
+enum Unwinder { kUnwinderUnknown, kFramePointers, kUnwindTables };
+
+inline std::atomic<int> unwinder{kUnwinderUnknown};
+
+class SpinGuard {
+
+private:
+
+    std::atomic_flag& flag;
+
+public:
+
+    explicit SpinGuard(std::atomic_flag& f) : flag(f) {
+        while (flag.test_and_set(std::memory_order_acquire)) {
+        }
+    }
+
+    ~SpinGuard() { flag.clear(std::memory_order_release); }
+
+    SpinGuard(const SpinGuard&) = delete;
+    SpinGuard& operator=(const SpinGuard&) = delete;
+};
+
+inline std::uint32_t sampleRate() {
+    static const std::uint32_t rate = [] {
+        const char* text = std::getenv("ALLOC_PROFILE_RATE");
+        return text ? static_cast<std::uint32_t>(std::strtoul(text, nullptr, 10)) : 1000u;
+    }();
+    return rate;
+}
+
+// Случайный интервал до следующей выборки со средним sampleRate(): не совпадает с периодом циклов программы
+inline std::int64_t nextSampleInterval() {
+    std::uint32_t rate = sampleRate();
+    if (rate == 0) {
+        return INT64_MAX;
+    }
+    thread_local std::uint64_t state = reinterpret_cast<std::uintptr_t>(&state) | 1;
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return 1 + static_cast<std::int64_t>(state % (2ull * rate - 1));
+}
+
+// Запись текущего потока при первом обращении к ней
+[[gnu::noinline]] inline ThreadRecord& createThreadRecord() {
+    ThreadRecord* record = static_cast<ThreadRecord*>(std::calloc(1, sizeof(ThreadRecord)));
+    if (!record) {
+        threadRecord = &spareRecord;
+        return spareRecord;
+    }
+    record->sampleCountdown = nextSampleInterval();
+    record->next = threadRecords.load(std::memory_order_relaxed);
+    while (!threadRecords.compare_exchange_weak(record->next, record, std::memory_order_release, std::memory_order_relaxed)) {
+    }
+    threadRecord = record;
+    return *record;
+}
+
+inline ThreadRecord& localRecord() {
+    ThreadRecord* record = threadRecord;
+    return record ? *record : createThreadRecord();
+}
+
+// Блок области под sampleLock; nullptr, если область не создалась или закончилась
+inline SampledHeader* arenaAllocate(std::size_t size) {
+    std::uint32_t sizeClass = 5;
+    while (sizeClass < kArenaClasses && (std::size_t(1) << sizeClass) < sizeof(SampledHeader) + size) {
+        ++sizeClass;
+    }
+    if (sizeClass == kArenaClasses || arenaFailed) {
+        return nullptr;
+    }
+    void* block = arenaFree[sizeClass];
+    if (block) {
+        std::memcpy(&arenaFree[sizeClass], block, sizeof(void*));
+    }
+    else {
+        if (!arenaTop) {
+            void* reserved = mmap(nullptr, kArenaBytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+            if (reserved == MAP_FAILED) {
+                arenaFailed = true;
+                return nullptr;
+            }
+            arenaTop = static_cast<char*>(reserved);
+            arenaBegin.store(reinterpret_cast<std::uintptr_t>(reserved), std::memory_order_release);
+        }
+        std::size_t blockSize = std::size_t(1) << sizeClass;
+        std::size_t used = reinterpret_cast<std::uintptr_t>(arenaTop) - arenaBegin.load(std::memory_order_relaxed);
+        if (kArenaBytes - used < blockSize) {
+            return nullptr;
+        }
+        block = arenaTop;
+        arenaTop += blockSize;
+    }
+    SampledHeader* header = static_cast<SampledHeader*>(block);
+    header->size = size;
+    header->sizeClass = sizeClass;
+    return header;
+}
+
+// Запись таблицы стеков для стека из frames; под sampleLock
+inline int stackIndex(void* const* frames, int depth) {
+    std::uint64_t hash = 14695981039346656037ull;
+    for (int i = 0; i < depth; ++i) {
+        hash = (hash ^ reinterpret_cast<std::uintptr_t>(frames[i])) * 1099511628211ull;
+    }
+    for (int i = 0; i < stackCount; ++i) {
+        if (stacks[i].hash == hash) {
+            return i;
+        }
+    }
+    if (stackCount == kMaxStacks) {
+        return kMaxStacks - 1;
+    }
+    StackEntry& entry = stacks[stackCount];
+    entry.hash = hash;
+    entry.depth = depth;
+    std::memcpy(entry.frames, frames, sizeof(void*) * depth);
+    return stackCount++;
+}
+
+inline std::uintptr_t currentStackEnd() {
+    pthread_attr_t attr;
+    void* low = nullptr;
+    std::size_t size = 0;
+    if (pthread_getattr_np(pthread_self(), &attr) == 0) {
+        pthread_attr_getstack(&attr, &low, &size);
+        pthread_attr_destroy(&attr);
+    }
+    return reinterpret_cast<std::uintptr_t>(low) + size;
+}
+
+// Стек по цепочке указателей кадров: десятки наносекунд, но только при сборке с -fno-omit-frame-pointer.
+// frame - кадр функции профилировщика: в нем сохраненный указатель кадра вызывающего и адрес возврата.
+// Проход останавливается, если следующий кадр не выше текущего или выходит за стек потока
+inline int walkFrames(void** frames, int capacity, void* const* frame) {
+    if (stackEnd == 0) {
+        stackEnd = currentStackEnd();
+    }
+    int count = 0;
+    while (count < capacity && frame[1]) {
+        frames[count++] = frame[1];
+        std::uintptr_t next = reinterpret_cast<std::uintptr_t>(frame[0]);
+        if (next <= reinterpret_cast<std::uintptr_t>(frame) || next % sizeof(void*) != 0 || next + 2 * sizeof(void*) > stackEnd) {
+            break;
+        }
+        frame = reinterpret_cast<void* const*>(next);
+    }
+    return count;
+}
+
+struct UnwindState {
+    void** frames;
+    int count;
+    int capacity;
+    void* start; // Кадры до этого адреса возврата - код профилировщика
+};
+
+inline _Unwind_Reason_Code collectFrame(_Unwind_Context* context, void* argument) {
+    UnwindState& state = *static_cast<UnwindState*>(argument);
+    void* ip = reinterpret_cast<void*>(_Unwind_GetIP(context));
+    if (state.start) {
+        if (ip != state.start) {
+            return _URC_NO_REASON;
+        }
+        state.start = nullptr;
+    }
+    state.frames[state.count++] = ip;
+    return state.count == state.capacity ? _URC_END_OF_STACK : _URC_NO_REASON;
+}
+
+// Стек по таблицам раскрутки: работает при любых флагах сборки, но стоит микросекунды
+inline int unwindFrames(void** frames, int capacity, void* start) {
+    UnwindState state{ frames, 0, capacity, start };
+    _Unwind_Backtrace(collectFrame, &state);
+    return state.count;
+}
+
+// Оба способа снимают стек от одного и того же кадра; без указателей кадров второй адрес разойдется
+[[gnu::noinline]] inline bool framePointersMatch() {
+    void* walked[2] = {};
+    void* unwound[2] = {};
+    int w = walkFrames(walked, 2, static_cast<void* const*>(__builtin_frame_address(0)));
+    int u = unwindFrames(unwound, 2, __builtin_return_address(0));
+    return w == 2 && u == 2 && walked[0] == unwound[0] && walked[1] == unwound[1];
+}
+
+// Отдельный кадр между проверкой и профилировщиком; работа после вызова не дает превратить его в переход
+[[gnu::noinline]] inline bool framePointersAvailable() {
+    bool match = framePointersMatch();
+    return match && stackEnd != 0;
+}
+
+// Стек выделения от адреса возврата site; frame - кадр функции, в которую site возвращает управление
+inline int captureStack(void** frames, void* const* frame, void* site) {
+    int mode = unwinder.load(std::memory_order_relaxed);
+    if (mode == kUnwinderUnknown) {
+        mode = framePointersAvailable() ? kFramePointers : kUnwindTables;
+        unwinder.store(mode, std::memory_order_relaxed);
+    }
+    return mode == kFramePointers ? walkFrames(frames, kMaxDepth, frame) : unwindFrames(frames, kMaxDepth, site);
+}
+
+// Выделение из выборки: стек вызова и блок из области; nullptr - выделить обычным путем.
+// Стек начинается с адреса возврата из countdownExpired (site, кадр frame), кадры профилировщика отрезаются
+inline void* allocateSampled(std::size_t size, void* const* frame, void* site) {
+    if (sampling) {
+        return nullptr; // Раскрутка по таблицам при первом обращении может выделять память
+    }
+    sampling = true;
+    void* frames[kMaxDepth];
+    int depth = captureStack(frames, frame, site);
+    sampling = false;
+    if (depth <= 0) {
+        return nullptr;
+    }
+
+    SpinGuard guard(sampleLock);
+    SampledHeader* header = arenaAllocate(size);
+    if (!header) {
+        return nullptr;
+    }
+    int index = stackIndex(frames, depth);
+    StackEntry& entry = stacks[index];
+    ++entry.allocations;
+    entry.bytes += size;
+    ++entry.liveAllocations;
+    entry.liveBytes += size;
+    header->stack = static_cast<std::uint32_t>(index + 1);
+    return header + 1;
+}
+
+[[gnu::noinline]] inline void releaseSampled(void* p) noexcept {
+    SampledHeader* header = static_cast<SampledHeader*>(p) - 1;
+    SpinGuard guard(sampleLock);
+    StackEntry& entry = stacks[header->stack - 1];
+    --entry.liveAllocations;
+    entry.liveBytes -= header->size;
+    std::uint32_t sizeClass = header->sizeClass;
+    std::memcpy(header, &arenaFree[sizeClass], sizeof(void*));
+    arenaFree[sizeClass] = header;
+}
+
+// Блок из области выборки? Одно сравнение на каждый delete
+inline bool isSampled(const void* p) {
+    return reinterpret_cast<std::uintptr_t>(p) - arenaBegin.load(std::memory_order_relaxed) < kArenaBytes;
+}
+
+// Срабатывание счетчика выборки; редкий путь вынесен, чтобы частый встраивался в operator new.
+// Первым в стеке остается место вызова operator new (или сам operator new, если компилятор его не встроил).
+// Сброс счетчика после вызова не дает превратить вызов в переход, и кадр остается на месте во время прохода
+[[gnu::noinline]] inline void* countdownExpired(ThreadRecord& record, std::size_t size) {
+    void* p = allocateSampled(size, static_cast<void* const*>(__builtin_frame_address(0)), __builtin_return_address(0));
+    record.sampleCountdown = nextSampleInterval();
+    return p;
+}
+
+inline void* allocate(ThreadRecord& record, std::size_t size) {
+    ++record.stats.allocations;
+    record.stats.bytes += size;
+    if (--record.sampleCountdown <= 0) {
+        if (void* p = countdownExpired(record, size)) {
+            return p;
+        }
+    }
+    if (void* p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+inline void* allocate(std::size_t size) {
+    return allocate(localRecord(), size);
+}
+
+inline void release(ThreadRecord& record, void* p) noexcept {
+    ++record.stats.frees;
+    if (isSampled(p)) {
+        releaseSampled(p);
+    }
+    else {
+        std::free(p);
+    }
+}
+
+inline void release(void* p) noexcept {
+    release(localRecord(), p);
+}
+
+// Номер типа по имени; вызывается один раз на класс из ALLOC_PROFILE_TYPE
+inline std::uint32_t registerType(const char* name) {
+    SpinGuard guard(typeLock);
+    int count = typeCount.load(std::memory_order_relaxed);
+    for (int i = 0; i < count; ++i) {
+        if (std::strcmp(typeNames[i], name) == 0) {
+            return static_cast<std::uint32_t>(i);
+        }
+    }
+    if (count == kMaxTypes) {
+        return kMaxTypes - 1;
+    }
+    typeNames[count] = name;
+    typeCount.store(count + 1, std::memory_order_release);
+    return static_cast<std::uint32_t>(count);
+}
+
+// operator new и delete класса с ALLOC_PROFILE_TYPE: запись потока ищется один раз на вызов
+inline void* allocateTyped(std::uint32_t type, std::size_t size) {
+    ThreadRecord& record = localRecord();
+    TypeCounters& entry = record.types[type];
+    ++entry.allocations;
+    entry.bytes += size;
+    return allocate(record, size);
+}
+
+inline void releaseTyped(std::uint32_t type, void* p, std::size_t size) noexcept {
+    if (p) {
+        ThreadRecord& record = localRecord();
+        TypeCounters& entry = record.types[type];
+        ++entry.frees;
+        entry.freedBytes += size;
+        release(record, p);
+    }
+}
+
+inline void printStacks(std::FILE* out, const char* title, std::uint64_t StackEntry::*key) {
+    StackEntry* order[kMaxStacks];
+    int count = 0;
+    for (int i = 0; i < stackCount; ++i) {
+        if (stacks[i].*key > 0) {
+            order[count++] = &stacks[i];
+        }
+    }
+    if (count == 0) {
+        return;
+    }
+    std::sort(order, order + count, [key](const StackEntry* a, const StackEntry* b) { return a->*key > b->*key; });
+    unsigned long long rate = sampleRate();
+    std::fprintf(out, "  %s (оценка: выборка x %llu):\n", title, rate);
+    for (int i = 0; i < count && i < kReportTop; ++i) {
+        const StackEntry& entry = *order[i];
+        std::fprintf(out, "    #%d ~%llu байт не освобождено в ~%llu блоках, всего ~%llu выделений на ~%llu байт\n", i + 1,
+            entry.liveBytes * rate, entry.liveAllocations * rate, entry.allocations * rate, entry.bytes * rate);
+        char** symbols = backtrace_symbols(entry.frames, entry.depth);
+        for (int f = 0; f < entry.depth; ++f) {
+            if (symbols) {
+                std::fprintf(out, "        %s\n", symbols[f]);
+            }
+            else {
+                std::fprintf(out, "        %p\n", entry.frames[f]);
+            }
+        }
+        std::free(symbols);
+    }
+}
+
+// Отчет: число не освобожденных блоков, живые объекты по типам и места выделения из выборки.
+// Суммируются записи всех потоков; счетчики еще работающих потоков читаются без синхронизации,
+// поэтому для них отчет приблизительный (при выходе из программы работают только оторванные)
+inline void writeReport(std::FILE* out) {
+    sampling = true; // Выделения во время отчета в выборку не попадают
+    Totals total = {};
+    for (const ThreadRecord* record = threadRecords.load(std::memory_order_acquire); record; record = record->next) {
+        total.stats.allocations += record->stats.allocations;
+        total.stats.frees += record->stats.frees;
+        total.stats.bytes += record->stats.bytes;
+        for (int i = 0; i < kMaxTypes; ++i) {
+            TypeCounters& to = total.types[i];
+            const TypeCounters& from = record->types[i];
+            to.allocations += from.allocations;
+            to.bytes += from.bytes;
+            to.frees += from.frees;
+            to.freedBytes += from.freedBytes;
+        }
+    }
+    std::fprintf(out, "[alloc_profile] выделений %llu (%llu байт), освобождений %llu, не освобождено блоков: %lld\n",
+        static_cast<unsigned long long>(total.stats.allocations), static_cast<unsigned long long>(total.stats.bytes),
+        static_cast<unsigned long long>(total.stats.frees),
+        static_cast<long long>(total.stats.allocations - total.stats.frees));
+    if (unwinder.load(std::memory_order_relaxed) == kUnwindTables) {
+        std::fprintf(out, "  стеки сняты по таблицам раскрутки (медленно): соберите с -fno-omit-frame-pointer\n");
+    }
+    int count = typeCount.load(std::memory_order_acquire);
+    for (int i = 0; i < count; ++i) {
+        const TypeCounters& entry = total.types[i];
+        std::fprintf(out, "  %s: живых %lld (%lld байт), всего выделено %llu (%llu байт)\n", typeNames[i],
+            static_cast<long long>(entry.allocations - entry.frees), static_cast<long long>(entry.bytes - entry.freedBytes),
+            static_cast<unsigned long long>(entry.allocations), static_cast<unsigned long long>(entry.bytes));
+    }
+    SpinGuard guard(sampleLock);
+    printStacks(out, "Места выделения не освобожденной памяти", &StackEntry::liveBytes);
+    printStacks(out, "Места выделения по объему", &StackEntry::bytes);
+    sampling = false;
+}
+
+// Создается до статических объектов программы (заголовок подключается первым), поэтому
+// разрушается после них и видит только то, что действительно не освобождено
+struct ExitReport {
+    ~ExitReport() { writeReport(stderr); }
+};
+
+inline ExitReport exitReport;
+
+} // namespace profile
+
+// Счетчики потока лежат в его записи профилировщика
+inline AllocStats& localStats() { return profile::localRecord().stats; }
+
+#else
+
+inline thread_local AllocStats threadStats;
+
+inline AllocStats& localStats() { return threadStats; }
+
+#endif
+
+// Счетчики текущего потока
+inline AllocStats current() { return localStats(); }
+
+// Запоминает счетчики при создании и показывает прирост с этого момента
+class AllocScope {
+
+private:
+
+    AllocStats start;
+
+public:
+
+    AllocScope() : start(localStats()) {}
+
+    AllocStats delta() const {
+        const AllocStats& now = localStats();
+        AllocStats d;
+        d.allocations = now.allocations - start.allocations;
+        d.frees = now.frees - start.frees;
+        d.bytes = now.bytes - start.bytes;
+        return d;
+    }
+};
+
+inline void* allocate(std::size_t size) {
+#if ALLOC_PROFILE
+    return profile::allocate(size);
+#else
+    ++threadStats.allocations;
+    threadStats.bytes += size;
+    if (void* p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+#endif
+}
+
+inline void release(void* p) noexcept {
+    if (p) {
+#if ALLOC_PROFILE
+        profile::release(p);
+#else
+        ++threadStats.frees;
+        std::free(p);
+#endif
+    }
+}
+
+} // namespace alloc_hooks
+
+void* operator new(std::size_t size) { return alloc_hooks::allocate(size); }
+void* operator new[](std::size_t size) { return alloc_hooks::allocate(size); }
+void operator delete(void* p) noexcept { alloc_hooks::release(p); }
+void operator delete[](void* p) noexcept { alloc_hooks::release(p); }
+void operator delete(void* p, std::size_t) noexcept { alloc_hooks::release(p); }
+void operator delete[](void* p, std::size_t) noexcept { alloc_hooks::release(p); }
+
+#if ALLOC_PROFILE
+
+// Учет живых объектов класса по имени; ставится внутри объявления класса.
+// Размер при удалении приходит в operator delete класса (для полиморфных - размер настоящего типа)
+#define ALLOC_PROFILE_TYPE(name)                                                                           \
+    static std::uint32_t allocProfileType() {                                                              \
+        static const std::uint32_t type = ::alloc_hooks::profile::registerType(name);                      \
+        return type;                                                                                       \
+    }                                                                                                      \
+    static void* operator new(std::size_t size) {                                                          \
+        return ::alloc_hooks::profile::allocateTyped(allocProfileType(), size);                            \
+    }                                                                                                      \
+    static void* operator new(std::size_t, void* place) noexcept { return place; }                         \
+    static void operator delete(void* p, std::size_t size) noexcept {                                      \
+        ::alloc_hooks::profile::releaseTyped(allocProfileType(), p, size);                                 \
+    }                                                                                                      \
+    static void operator delete(void*, void*) noexcept {}
+
+#else
+
+#define ALLOC_PROFILE_TYPE(name)
+
+#endif
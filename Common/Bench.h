@@ -0,0 +1,220 @@
+#pragma once
+
+// Общие утилиты для замеров производительности в демонстрационных программах
+
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <streambuf>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+namespace bench {
+
+// Текущее значение монотонных часов в наносекундах
+inline std::uint64_t nowNs() {
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+// Секундомер: запускается при создании
+class Stopwatch {
+
+private:
+
+    std::uint64_t start;
+
+public:
+
+    Stopwatch() : start(nowNs()) {}
+
+    void restart() { start = nowNs(); }
+
+    std::uint64_t elapsedNs() const { return nowNs() - start; }
+};
+
+// Не дает компилятору выбросить вычисленное значение
+template <class T>
+inline void doNotOptimize(const T& value) {
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : "r,m"(value) : "memory");
+#else
+    static volatile const void* sink;
+    sink = &value;
+#endif
+}
+
+// Необязательный числовой аргумент командной строки argv[index]: только цифры целиком, без знака
+// и переполнения, не меньше minimum. Без аргумента value не меняется; при ошибке - сообщение в cerr и false
+template <class T>
+bool countArg(int argc, char* argv[], int index, T& value, std::uint64_t minimum = 1) {
+    if (argc <= index) {
+        return true;
+    }
+    const char* text = argv[index];
+    const char* end = text + std::strlen(text);
+    T parsed = 0;
+    auto [ptr, ec] = std::from_chars(text, end, parsed);
+    if (ec != std::errc() || ptr != end) {
+        std::cerr << "Неверное число '" << text << "'" << std::endl;
+        return false;
+    }
+    if (parsed < minimum) {
+        std::cerr << "Число '" << text << "' должно быть не меньше " << minimum << std::endl;
+        return false;
+    }
+    value = parsed;
+    return true;
+}
+
+// Буфер потока, отбрасывающий весь вывод
+class NullBuffer : public std::streambuf {
+
+protected:
+
+    int_type overflow(int_type c) override { return traits_type::not_eof(c); }
+
+    std::streamsize xsputn(const char*, std::streamsize n) override { return n; }
+};
+
+// Глушит поток (обычно cout) на время жизни объекта
+class MuteStream {
+
+private:
+
+    std::ostream& stream;
+    std::streambuf* saved;
+    NullBuffer nullBuffer;
+
+public:
+
+    explicit MuteStream(std::ostream& s) : stream(s), saved(s.rdbuf(&nullBuffer)) {}
+
+    ~MuteStream() { stream.rdbuf(saved); }
+
+    MuteStream(const MuteStream&) = delete;
+    MuteStream& operator=(const MuteStream&) = delete;
+};
+
+// Резидентная память процесса в килобайтах (0, если узнать нельзя)
+inline std::size_t currentRssKb() {
+#if defined(__linux__)
+    std::FILE* f = std::fopen("/proc/self/statm", "r");
+    if (!f) {
+        return 0;
+    }
+    unsigned long pages = 0, resident = 0;
+    int read = std::fscanf(f, "%lu %lu", &pages, &resident);
+    std::fclose(f);
+    return read == 2 ? resident * static_cast<std::size_t>(sysconf(_SC_PAGESIZE) / 1024) : 0;
+#else
+    return 0;
+#endif
+}
+
+// Аппаратный счетчик текущего потока через perf_event_open (промахи кэша, промахи предсказания
+// переходов и т. п.). В виртуальных машинах и на других ОС счетчики часто недоступны:
+// тогда available() == false, а stop() возвращает 0
+class PerfCounter {
+
+private:
+
+    int fd = -1;
+
+public:
+
+    PerfCounter(std::uint32_t type, std::uint64_t config) {
+#if defined(__linux__)
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = type;
+        attr.config = config;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        fd = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+#else
+        (void)type;
+        (void)config;
+#endif
+    }
+
+    ~PerfCounter() {
+#if defined(__linux__)
+        if (fd >= 0) {
+            close(fd);
+        }
+#endif
+    }
+
+    PerfCounter(const PerfCounter&) = delete;
+    PerfCounter& operator=(const PerfCounter&) = delete;
+
+#if defined(__linux__)
+    static PerfCounter cacheMisses() { return PerfCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES); }
+
+    static PerfCounter branchMisses() { return PerfCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES); }
+#else
+    static PerfCounter cacheMisses() { return PerfCounter(0, 0); }
+
+    static PerfCounter branchMisses() { return PerfCounter(0, 0); }
+#endif
+
+    bool available() const { return fd >= 0; }
+
+    void start() {
+#if defined(__linux__)
+        if (fd >= 0) {
+            ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+#endif
+    }
+
+    // Останавливает счет и возвращает накопленное значение
+    std::uint64_t stop() {
+        std::uint64_t value = 0;
+#if defined(__linux__)
+        if (fd >= 0) {
+            ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+            if (read(fd, &value, sizeof(value)) != static_cast<ssize_t>(sizeof(value))) {
+                value = 0;
+            }
+        }
+#endif
+        return value;
+    }
+};
+
+// Выполняет замер в отдельном процессе, чтобы RSS одного варианта не влиял на другой
+// (освобожденную память куча процессу обычно не возвращает). Без fork просто вызывает run()
+template <class Run>
+void runIsolated(Run&& run) {
+#if defined(__linux__)
+    std::fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) {
+        run();
+        std::fflush(stdout);
+        _exit(0);
+    }
+    if (pid > 0) {
+        int status = 0;
+        waitpid(pid, &status, 0);
+        return;
+    }
+#endif
+    run();
+}
+
+} // namespace bench
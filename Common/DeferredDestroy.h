@@ -0,0 +1,252 @@
+#pragma once
+
+// Отложенное уничтожение объектов: деструктор и освобождение памяти уходят с горячего пути.
+//
+// Объект, переданный в deferred::retire() (или удаляемый через deferred::Delete<T> в unique_ptr),
+// попадает в список текущего потока. Заполненный список целой пачкой передается уничтожителю
+// (одна блокировка мьютекса на пачку). Дальше пачки уничтожаются:
+//   Mode::Background - фоновым потоком сразу после передачи. Поток работает с политикой SCHED_IDLE
+//                      и занимает только простаивающее ядро: когда свободных ядер нет, пачки копятся;
+//   Mode::Quiescent  - только при вызове quiescent() в "тихой" точке программы
+//                      (между запросами, в простое), в вызывающем потоке.
+// Порядок уничтожения внутри пачки - Order::Fifo (в порядке передачи) или Order::Lifo.
+// Механизм включается явно: объекты, не переданные в retire(), удаляются как обычно.
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace deferred {
+
+enum class Mode { Background, Quiescent };
+
+enum class Order { Fifo, Lifo };
+
+// Объект, ждущий уничтожения
+struct Retired {
+    void* object;
+    void (*destroy)(void*);
+};
+
+class Reclaimer {
+
+private:
+
+    // Список потока: копит объекты и отдает их пачкой
+    struct ThreadList {
+        std::vector<Retired> items;
+
+        ~ThreadList() {
+            if (!items.empty()) {
+                Reclaimer::instance().submit(items);
+            }
+        }
+    };
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::vector<std::vector<Retired>> batches; // Переданные пачки, под mutex
+    std::vector<std::vector<Retired>> spare;   // Опустевшие пачки с выделенной памятью, под mutex
+    std::thread worker;
+    bool stopping = false;
+
+    std::atomic<Mode> mode{Mode::Background};
+    std::atomic<Order> order{Order::Fifo};
+    std::atomic<std::size_t> batchSize{256};
+
+    std::atomic<std::uint64_t> retiredCount{0};
+    std::atomic<std::uint64_t> destroyedCount{0};
+    std::atomic<std::uint64_t> batchCount{0};
+
+    Reclaimer() = default;
+
+    static ThreadList& localList() {
+        thread_local ThreadList list;
+        return list;
+    }
+
+    void destroyBatch(std::vector<Retired>& batch) {
+        if (order.load(std::memory_order_relaxed) == Order::Fifo) {
+            for (Retired& r : batch) {
+                r.destroy(r.object);
+            }
+        }
+        else {
+            for (std::size_t i = batch.size(); i-- > 0;) {
+                batch[i].destroy(batch[i].object);
+            }
+        }
+        destroyedCount.fetch_add(batch.size(), std::memory_order_relaxed);
+        batchCount.fetch_add(1, std::memory_order_relaxed);
+        batch.clear();
+    }
+
+    // Возвращает опустевшие пачки в запас (вызывается под mutex).
+    // Без этого submit() выделял бы новый буфер на горячем пути, а крупное выделение
+    // сразу после массового освобождения заставляет malloc сливать тысячи свободных блоков
+    void recycle(std::vector<std::vector<Retired>>& taken) {
+        for (auto& batch : taken) {
+            spare.push_back(std::move(batch));
+        }
+        taken.clear();
+        if (batches.empty() && batches.capacity() < taken.capacity()) {
+            batches.swap(taken);
+        }
+    }
+
+    // Забирает все переданные пачки и уничтожает их вне блокировки
+    void drainSubmitted() {
+        std::vector<std::vector<Retired>> taken;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            taken.swap(batches);
+        }
+        if (taken.empty()) {
+            return;
+        }
+        for (auto& batch : taken) {
+            destroyBatch(batch);
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        recycle(taken);
+    }
+
+    void run() {
+#ifdef __linux__
+        sched_param param{};
+        pthread_setschedparam(pthread_self(), SCHED_IDLE, &param);
+#endif
+        std::unique_lock<std::mutex> lock(mutex);
+        for (;;) {
+            wake.wait(lock, [this] { return stopping || !batches.empty(); });
+            if (batches.empty() && stopping) {
+                return;
+            }
+            std::vector<std::vector<Retired>> taken;
+            taken.swap(batches);
+            lock.unlock();
+            for (auto& batch : taken) {
+                destroyBatch(batch);
+            }
+            lock.lock();
+            recycle(taken);
+        }
+    }
+
+    void submit(std::vector<Retired>& items) {
+        std::vector<Retired> batch;
+        batch.swap(items);
+        bool background = false;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            batches.push_back(std::move(batch));
+            if (!spare.empty()) {
+                items.swap(spare.back());
+                spare.pop_back();
+            }
+            background = mode.load(std::memory_order_relaxed) == Mode::Background && !stopping;
+            if (background && !worker.joinable()) {
+                worker = std::thread([this] { run(); });
+            }
+        }
+        if (items.capacity() == 0) {
+            items.reserve(batchSize.load(std::memory_order_relaxed));
+        }
+        if (background) {
+            wake.notify_one();
+        }
+    }
+
+public:
+
+    static Reclaimer& instance() {
+        static Reclaimer reclaimer;
+        return reclaimer;
+    }
+
+    // Останавливает фоновый поток и уничтожает все, что осталось
+    ~Reclaimer() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_one();
+        if (worker.joinable()) {
+            worker.join();
+        }
+        drainSubmitted();
+    }
+
+    Reclaimer(const Reclaimer&) = delete;
+    Reclaimer& operator=(const Reclaimer&) = delete;
+
+    // Настройка; менять режим лучше до первого retire()
+    void configure(Mode newMode, Order newOrder = Order::Fifo, std::size_t newBatchSize = 256) {
+        mode.store(newMode);
+        order.store(newOrder);
+        batchSize.store(newBatchSize > 0 ? newBatchSize : 1);
+    }
+
+    template <class T>
+    void retire(T* object) {
+        if (!object) {
+            return;
+        }
+        ThreadList& list = localList();
+        list.items.push_back({ object, [](void* p) { delete static_cast<T*>(p); } });
+        retiredCount.fetch_add(1, std::memory_order_relaxed);
+        if (list.items.size() >= batchSize.load(std::memory_order_relaxed)) {
+            submit(list.items);
+        }
+    }
+
+    // Передает неполную пачку текущего потока (в фоновом режиме ее уничтожит фоновый поток)
+    void flush() {
+        ThreadList& list = localList();
+        if (!list.items.empty()) {
+            submit(list.items);
+        }
+    }
+
+    // Тихая точка: список текущего потока и все переданные пачки уничтожаются здесь же
+    void quiescent() {
+        ThreadList& list = localList();
+        if (!list.items.empty()) {
+            destroyBatch(list.items);
+        }
+        drainSubmitted();
+    }
+
+    std::uint64_t retired() const { return retiredCount.load(std::memory_order_relaxed); }
+
+    std::uint64_t destroyed() const { return destroyedCount.load(std::memory_order_relaxed); }
+
+    std::uint64_t batchesDestroyed() const { return batchCount.load(std::memory_order_relaxed); }
+};
+
+template <class T>
+void retire(T* object) {
+    Reclaimer::instance().retire(object);
+}
+
+inline void quiescent() {
+    Reclaimer::instance().quiescent();
+}
+
+// Удалитель для unique_ptr/shared_ptr: unique_ptr<Ingredient, deferred::Delete<Ingredient>>
+template <class T>
+struct Delete {
+    void operator()(T* object) const { retire(object); }
+};
+
+} // namespace deferred
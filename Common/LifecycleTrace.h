@@ -0,0 +1,378 @@
+#pragma once
+
+// Трассировка событий жизненного цикла объектов: конструкторы, деструкторы, присваивания.
+//
+// Режим выбирается при компиляции макросом LIFECYCLE_TRACE_MODE:
+//   0 - трассировка вырезана полностью, аргументы сообщений даже не вычисляются;
+//   1 - синхронный текст в cout (по умолчанию), вывод побайтно совпадает с прежним cout << ... << endl,
+//       но без принудительного сброса буфера на каждой строке;
+//   2 - асинхронный текст: сообщение форматируется в потоке-источнике, кладется в его собственный
+//       кольцевой буфер без блокировок и пачками выводится в stdout фоновым потоком.
+//       Пока cout перенаправлен (например, bench::MuteStream), строки пишутся прямо в cout;
+//   3 - асинхронный двоичный формат: те же записи с меткой времени и номером потока
+//       пишутся в файл из переменной окружения LIFECYCLE_TRACE_FILE (по умолчанию lifecycle.trace).
+//
+// В асинхронных режимах строки трассировки могут обгонять или отставать от прямого вывода в cout.
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef LIFECYCLE_TRACE_MODE
+#define LIFECYCLE_TRACE_MODE 1
+#endif
+
+namespace lifecycle {
+
+// Глобальное отключение трассировки во время выполнения (например, на время замеров)
+inline std::atomic<bool> muted{false};
+
+inline bool isMuted() { return muted.load(std::memory_order_relaxed); }
+
+// Отключает трассировку на время жизни объекта
+class ScopedMute {
+
+private:
+
+    bool saved;
+
+public:
+
+    ScopedMute() : saved(muted.exchange(true)) {}
+
+    ~ScopedMute() { muted.store(saved); }
+
+    ScopedMute(const ScopedMute&) = delete;
+    ScopedMute& operator=(const ScopedMute&) = delete;
+};
+
+// Политика 0: ничего не делает
+struct NoTracePolicy {
+
+    static constexpr bool enabled = false;
+
+    template <class Writer>
+    static void emit(Writer&&) {}
+};
+
+// Политика 1: синхронный текст в cout
+struct SyncTextPolicy {
+
+    static constexpr bool enabled = true;
+
+    template <class Writer>
+    static void emit(Writer&& write) {
+        write(std::cout);
+        std::cout << '\n';
+    }
+};
+
+// Кольцевой буфер одного производителя (поток-источник) и одного потребителя (фоновый писатель)
+class SpscRing {
+
+public:
+
+    static constexpr std::size_t kCapacity = std::size_t(1) << 16;
+
+    // Заголовок записи; за ним идут length байт текста
+    struct Header {
+        std::uint32_t length;
+        std::uint32_t thread;
+        std::uint64_t timeNs;
+    };
+
+private:
+
+    static constexpr std::size_t kMask = kCapacity - 1;
+
+    alignas(64) std::atomic<std::size_t> head{0}; // Пишет только производитель
+    alignas(64) std::atomic<std::size_t> tail{0}; // Пишет только потребитель
+    alignas(64) char data[kCapacity];
+
+    void copyIn(std::size_t pos, const void* src, std::size_t n) {
+        std::size_t offset = pos & kMask;
+        std::size_t first = n < kCapacity - offset ? n : kCapacity - offset;
+        std::memcpy(data + offset, src, first);
+        std::memcpy(data, static_cast<const char*>(src) + first, n - first);
+    }
+
+    void copyOut(std::size_t pos, void* dst, std::size_t n) const {
+        std::size_t offset = pos & kMask;
+        std::size_t first = n < kCapacity - offset ? n : kCapacity - offset;
+        std::memcpy(dst, data + offset, first);
+        std::memcpy(static_cast<char*>(dst) + first, data, n - first);
+    }
+
+public:
+
+    // Все записи забраны потребителем
+    bool empty() const {
+        return tail.load(std::memory_order_acquire) == head.load(std::memory_order_acquire);
+    }
+
+    // Добавляет запись; false, если места сейчас нет
+    bool tryPush(const Header& header, const char* text) {
+        std::size_t need = sizeof(Header) + header.length;
+        std::size_t h = head.load(std::memory_order_relaxed);
+        if (kCapacity - (h - tail.load(std::memory_order_acquire)) < need) {
+            return false;
+        }
+        copyIn(h, &header, sizeof(Header));
+        copyIn(h + sizeof(Header), text, header.length);
+        head.store(h + need, std::memory_order_release);
+        return true;
+    }
+
+    // Забирает все накопленные записи; append(header, text) вызывается для каждой
+    template <class Append>
+    std::size_t drain(std::string& scratch, Append&& append) {
+        std::size_t t = tail.load(std::memory_order_relaxed);
+        std::size_t h = head.load(std::memory_order_acquire);
+        std::size_t count = 0;
+        while (t != h) {
+            Header header;
+            copyOut(t, &header, sizeof(Header));
+            scratch.resize(header.length);
+            copyOut(t + sizeof(Header), &scratch[0], header.length);
+            append(header, scratch);
+            t += sizeof(Header) + header.length;
+            ++count;
+        }
+        tail.store(t, std::memory_order_release);
+        return count;
+    }
+};
+
+// Писатель уже остановлен (завершение программы): дальше пишем синхронно
+inline std::atomic<bool> sinkClosed{false};
+
+// Исходный буфер cout; если cout перенаправлен, текст трассировки идет синхронно туда же
+inline std::streambuf* const stdoutBuffer = std::cout.rdbuf();
+
+// Фоновый писатель: опрашивает кольцевые буферы всех потоков и выводит записи пачками
+class AsyncSink {
+
+private:
+
+    // Буфер и признак того, что им владеет живой поток
+    struct Slot {
+        SpscRing ring;
+        std::atomic<bool> inUse{true};
+    };
+
+    // Владелец буфера в потоке: при завершении потока возвращает буфер для повторного использования.
+    // Сначала ждет, пока писатель выведет остатки, чтобы синхронные строки после него не обогнали их
+    struct SlotOwner {
+        Slot* slot = nullptr;
+
+        ~SlotOwner() {
+            if (slot) {
+                while (!slot->ring.empty() && !sinkClosed.load()) {
+                    std::this_thread::yield();
+                }
+                slot->inUse.store(false, std::memory_order_release);
+            }
+            threadFinished() = true;
+        }
+    };
+
+    static bool& threadFinished() {
+        thread_local bool finished = false; // Тривиальный: доступен и после деструкторов потока
+        return finished;
+    }
+
+    std::mutex registryMutex; // Только для регистрации новых потоков, не на горячем пути
+    std::vector<std::unique_ptr<Slot>> slots; // Растет только до наибольшего числа одновременных потоков
+    std::vector<SpscRing*> snapshot; // Только для писателя
+    std::atomic<std::uint32_t> nextThread{0};
+    std::atomic<bool> stopping{false};
+    std::FILE* out;
+    bool binary;
+    std::thread writer;
+
+    AsyncSink(bool binaryFormat) : binary(binaryFormat) {
+        if (binary) {
+            const char* path = std::getenv("LIFECYCLE_TRACE_FILE");
+            out = std::fopen(path ? path : "lifecycle.trace", "wb");
+            if (out) {
+                std::fwrite("LCTRACE1", 1, 8, out);
+            }
+        }
+        else {
+            out = stdout;
+        }
+        writer = std::thread([this] { run(); });
+    }
+
+    // Свободный буфер завершившегося потока берется, только когда писатель уже вывел его остатки
+    Slot* registerThread() {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        for (auto& slot : slots) {
+            if (!slot->inUse.load(std::memory_order_acquire) && slot->ring.empty()) {
+                slot->inUse.store(true, std::memory_order_relaxed);
+                return slot.get();
+            }
+        }
+        slots.push_back(std::make_unique<Slot>());
+        return slots.back().get();
+    }
+
+    // Один проход по всем буферам; возвращает число выведенных записей
+    std::size_t drainAll(std::string& batch, std::string& scratch) {
+        snapshot.clear();
+        {
+            std::lock_guard<std::mutex> lock(registryMutex);
+            for (auto& slot : slots) {
+                snapshot.push_back(&slot->ring);
+            }
+        }
+
+        std::size_t count = 0;
+        for (SpscRing* ring : snapshot) {
+            count += ring->drain(scratch, [&](const SpscRing::Header& header, const std::string& text) {
+                if (binary) {
+                    batch.append(reinterpret_cast<const char*>(&header), sizeof(header));
+                    batch.append(text);
+                }
+                else {
+                    batch.append(text);
+                    batch.push_back('\n');
+                }
+            });
+        }
+
+        if (!batch.empty() && out) {
+            std::fwrite(batch.data(), 1, batch.size(), out);
+            std::fflush(out);
+        }
+        batch.clear();
+
+        return count;
+    }
+
+    void run() {
+        std::string batch, scratch;
+        batch.reserve(SpscRing::kCapacity);
+        while (!stopping.load(std::memory_order_acquire)) {
+            if (drainAll(batch, scratch) == 0) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        }
+        drainAll(batch, scratch); // Остатки после остановки
+    }
+
+public:
+
+    static AsyncSink& instance(bool binaryFormat) {
+        static AsyncSink sink(binaryFormat);
+        return sink;
+    }
+
+    ~AsyncSink() {
+        sinkClosed.store(true);
+        stopping.store(true, std::memory_order_release);
+        writer.join();
+        if (out && out != stdout) {
+            std::fclose(out);
+        }
+    }
+
+    // Добавляет запись в буфер текущего потока; при переполнении ждет писателя.
+    // false, если буфер потока уже возвращен (сообщение из деструктора thread_local-объекта)
+    bool push(const std::string& text) {
+        if (threadFinished()) {
+            return false;
+        }
+        thread_local std::uint32_t index = nextThread.fetch_add(1, std::memory_order_relaxed);
+        thread_local SlotOwner owner;
+        if (!owner.slot) {
+            owner.slot = registerThread();
+        }
+
+        SpscRing::Header header;
+        std::size_t limit = SpscRing::kCapacity / 2 - sizeof(header);
+        header.length = static_cast<std::uint32_t>(text.size() < limit ? text.size() : limit);
+        header.thread = index;
+        header.timeNs = static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+
+        while (!owner.slot->ring.tryPush(header, text.data())) {
+            std::this_thread::yield();
+        }
+        return true;
+    }
+};
+
+// Буфер потока, дописывающий символы в строку (память переиспользуется между сообщениями)
+class StringAppendBuffer : public std::streambuf {
+
+public:
+
+    std::string text;
+
+protected:
+
+    int_type overflow(int_type c) override {
+        if (!traits_type::eq_int_type(c, traits_type::eof())) {
+            text.push_back(traits_type::to_char_type(c));
+        }
+        return traits_type::not_eof(c);
+    }
+
+    std::streamsize xsputn(const char* s, std::streamsize n) override {
+        text.append(s, static_cast<std::size_t>(n));
+        return n;
+    }
+};
+
+// Политики 2 и 3: асинхронный вывод через кольцевые буферы потоков
+template <bool Binary>
+struct AsyncPolicy {
+
+    static constexpr bool enabled = true;
+
+    template <class Writer>
+    static void emit(Writer&& write) {
+        thread_local StringAppendBuffer buffer;
+        thread_local std::ostream stream(&buffer);
+        buffer.text.clear();
+        write(stream);
+        bool redirected = !Binary && std::cout.rdbuf() != stdoutBuffer;
+        if (redirected || sinkClosed.load(std::memory_order_relaxed) || !AsyncSink::instance(Binary).push(buffer.text)) {
+            std::cout << buffer.text << '\n';
+        }
+    }
+};
+
+#if LIFECYCLE_TRACE_MODE == 0
+using ActivePolicy = NoTracePolicy;
+#elif LIFECYCLE_TRACE_MODE == 1
+using ActivePolicy = SyncTextPolicy;
+#elif LIFECYCLE_TRACE_MODE == 2
+using ActivePolicy = AsyncPolicy<false>;
+#elif LIFECYCLE_TRACE_MODE == 3
+using ActivePolicy = AsyncPolicy<true>;
+#else
+#error "LIFECYCLE_TRACE_MODE must be 0, 1, 2 or 3"
+#endif
+
+} // namespace lifecycle
+
+// Сообщение о событии жизненного цикла: LIFECYCLE_TRACE("Конструктор Point(" << x << ")");
+#define LIFECYCLE_TRACE(expr)                                                                          \
+    do {                                                                                               \
+        if constexpr (::lifecycle::ActivePolicy::enabled) {                                            \
+            if (!::lifecycle::isMuted()) {                                                             \
+                ::lifecycle::ActivePolicy::emit([&](std::ostream& lifecycle_out_) { lifecycle_out_ << expr; }); \
+            }                                                                                          \
+        }                                                                                              \
+    } while (false)
@@ -0,0 +1,80 @@
+#pragma once
+
+// Сборка имен объектов из частей одним выделением памяти: длина считается заранее.
+// Части - все, что приводится к std::string_view (строки, литералы), символы и целые числа.
+//
+//   names::concat("Фрукт #", 7)         -> std::string "Фрукт #7"
+//   names::makeNamed<Fruit>("Фрукт #", 7) -> std::unique_ptr<Fruit>, имя перемещается в конструктор
+//   names::isCString<T>                  -> T - литерал, буфер char или указатель на char (но не nullptr)
+
+#include <charconv>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+namespace names {
+
+namespace detail {
+
+// Часть имени в виде готовых символов: текст ссылается на исходную строку, число - на свой буфер
+struct Piece {
+
+    char digits[24];
+    std::string_view text;
+
+    template <class T>
+    explicit Piece(const T& value) {
+        if constexpr (std::is_same<T, char>::value) {
+            digits[0] = value;
+            text = std::string_view(digits, 1);
+        }
+        else if constexpr (std::is_integral<T>::value) {
+            static_assert(!std::is_same<T, bool>::value, "bool в имени не поддерживается");
+            std::to_chars_result result = std::to_chars(digits, digits + sizeof(digits), value);
+            text = std::string_view(digits, static_cast<std::size_t>(result.ptr - digits));
+        }
+        else {
+            text = std::string_view(value);
+        }
+    }
+
+    Piece(const Piece&) = delete;
+    Piece& operator=(const Piece&) = delete;
+};
+
+} // namespace detail
+
+// Строка в стиле C: литерал, массив char или указатель на char. nullptr_t сюда не входит,
+// чтобы конструктор с таким ограничением не перехватывал nullptr у перегрузок с указателями
+template <class T>
+constexpr bool isCString = std::is_convertible<const T&, const char*>::value && !std::is_null_pointer<T>::value;
+
+template <class... Parts>
+std::string concat(const Parts&... parts) {
+
+    static_assert(sizeof...(Parts) > 0, "Имя должно состоять хотя бы из одной части");
+
+    const detail::Piece pieces[] = { detail::Piece(parts)... };
+    std::size_t length = 0;
+    for (const detail::Piece& piece : pieces) {
+        length += piece.text.size();
+    }
+
+    std::string result;
+    result.reserve(length);
+    for (const detail::Piece& piece : pieces) {
+        result.append(piece.text);
+    }
+
+    return result;
+}
+
+// Создает объект в куче с именем из частей; у T должен быть конструктор, принимающий std::string
+template <class T, class... Parts>
+std::unique_ptr<T> makeNamed(const Parts&... parts) {
+    return std::make_unique<T>(concat(parts...));
+}
+
+} // namespace names
@@ -0,0 +1,554 @@
+#pragma once
+
+// Замер участков кода изнутри программы: время и аппаратные счетчики по именованным областям.
+//
+// Включается при компиляции: -DPERF_REGIONS=1. По умолчанию макросы ничего не делают
+// и выражения в PERF_REGION_EXPR вычисляются как обычно.
+//
+//   PERF_REGION("OOP2/Rectangle::operator=");                    // до конца текущего блока
+//   Fruit* f = PERF_REGION_EXPR("Program2/dynamic_cast", dynamic_cast<Fruit*>(ptr));
+//
+// Для каждого потока открывается группа счетчиков perf_event_open (циклы, инструкции,
+// промахи кэша, промахи предсказания переходов). Счетчики читаются инструкцией rdpmc через
+// отображенную в память страницу perf; если ядро ее не разрешает - одним read() на группу.
+// Время на x86-64 берется из rdtsc (частота калибруется по clock_gettime при первой регистрации
+// области), на других платформах - из clock_gettime. Если perf недоступен (другая ОС, виртуальная
+// машина, запрет в perf_event_paranoid), пишется только время.
+//
+// Статистика копится в потоке без блокировок и сливается в общую при завершении потока.
+// Вход и выход из области не выделяют память, не берут мьютексов и не бросают исключений,
+// поэтому PERF_REGION можно ставить и в noexcept-функции. Области регистрируются при первом
+// проходе (до kMaxRegions имен; лишние не замеряются).
+// При завершении программы по каждой области сохраняются число входов, сумма, минимум,
+// максимум и гистограмма по степеням двойки (корзина i - значения в [2^(i-1), 2^i)) в JSON:
+// файл из переменной окружения PERF_REGIONS_FILE, по умолчанию perf_regions.json.
+// Потоки, еще работающие при завершении программы, в отчет не попадают.
+
+#ifndef PERF_REGIONS
+#define PERF_REGIONS 0
+#endif
+
+#if PERF_REGIONS
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <thread>
+#include <time.h>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define PERF_REGIONS_X86 1
+#else
+#define PERF_REGIONS_X86 0
+#endif
+
+namespace perf_regions {
+
+enum Metric { kNs, kCycles, kInstructions, kCacheMisses, kBranchMisses, kMetricCount };
+
+inline const char* const kMetricNames[kMetricCount] = { "ns", "cycles", "instructions", "cache_misses", "branch_misses" };
+
+constexpr int kBuckets = 65;
+
+constexpr int kMaxRegions = 64;
+
+// Показания на входе или выходе из области; время - в тактах clockTicks()
+struct Reading {
+    std::uint64_t values[kMetricCount] = {};
+    bool valid[kMetricCount] = {};
+};
+
+// Распределение одной величины
+struct Distribution {
+
+    std::uint64_t total = 0;
+    std::uint64_t min = ~std::uint64_t(0);
+    std::uint64_t max = 0;
+    std::uint64_t buckets[kBuckets] = {};
+
+    void add(std::uint64_t value) {
+        total += value;
+        min = value < min ? value : min;
+        max = value > max ? value : max;
+#if defined(__GNUC__) || defined(__clang__)
+        int bucket = value ? 64 - __builtin_clzll(value) : 0;
+#else
+        int bucket = 0;
+        for (std::uint64_t v = value; v != 0; v >>= 1) {
+            ++bucket;
+        }
+#endif
+        ++buckets[bucket];
+    }
+
+    void merge(const Distribution& other) {
+        total += other.total;
+        min = other.min < min ? other.min : min;
+        max = other.max > max ? other.max : max;
+        for (int b = 0; b < kBuckets; ++b) {
+            buckets[b] += other.buckets[b];
+        }
+    }
+};
+
+// Статистика одной области: своя у каждого потока и общая в Registry
+struct RegionStats {
+
+    std::uint64_t count = 0;
+    Distribution metrics[kMetricCount];
+    std::uint64_t samples[kMetricCount] = {}; // Сколько входов дали значение метрики
+
+    void record(const Reading& begin, const Reading& end, double nsPerTick) {
+        ++count;
+        for (int m = 0; m < kMetricCount; ++m) {
+            if (begin.valid[m] && end.valid[m]) {
+                std::uint64_t delta = end.values[m] - begin.values[m];
+                if (m == kNs) {
+                    delta = static_cast<std::uint64_t>(static_cast<double>(delta) * nsPerTick);
+                }
+                metrics[m].add(delta);
+                ++samples[m];
+            }
+        }
+    }
+
+    void merge(const RegionStats& other) {
+        count += other.count;
+        for (int m = 0; m < kMetricCount; ++m) {
+            if (other.samples[m] > 0) {
+                metrics[m].merge(other.metrics[m]);
+                samples[m] += other.samples[m];
+            }
+        }
+    }
+};
+
+inline std::uint64_t monotonicNs() {
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return static_cast<std::uint64_t>(now.tv_sec) * 1000000000ull + static_cast<std::uint64_t>(now.tv_nsec);
+}
+
+// Такты для замера времени: счетчик TSC (постоянной частоты на современных x86) или наносекунды
+inline std::uint64_t clockTicks() {
+#if PERF_REGIONS_X86
+    return __rdtsc();
+#else
+    return monotonicNs();
+#endif
+}
+
+// Группа счетчиков текущего потока: лидер - циклы, остальные читаются вместе с ним
+class CounterGroup {
+
+private:
+
+    int leader = -1;
+    int fds[kMetricCount];
+    int slot[kMetricCount]; // Позиция метрики в ответе read() или -1
+#if defined(__linux__)
+    perf_event_mmap_page* pages[kMetricCount] = {}; // Для rdpmc; nullptr, если отобразить не удалось
+#endif
+
+#if defined(__linux__) && PERF_REGIONS_X86
+    // Значение счетчика без системного вызова; false, если ядро сейчас не дает читать его через rdpmc
+    static bool readMapped(const perf_event_mmap_page* page, std::uint64_t& value) {
+        const volatile perf_event_mmap_page* pc = page;
+        std::uint32_t sequence;
+        std::uint64_t count;
+        do {
+            sequence = pc->lock;
+            std::atomic_signal_fence(std::memory_order_seq_cst);
+            std::uint32_t index = pc->index;
+            if (!pc->cap_user_rdpmc || index == 0) {
+                return false;
+            }
+            count = pc->offset;
+            unsigned width = pc->pmc_width;
+            std::int64_t raw = static_cast<std::int64_t>(__rdpmc(static_cast<int>(index - 1)));
+            raw = static_cast<std::int64_t>(static_cast<std::uint64_t>(raw) << (64 - width)) >> (64 - width);
+            count += static_cast<std::uint64_t>(raw);
+            std::atomic_signal_fence(std::memory_order_seq_cst);
+        } while (pc->lock != sequence);
+        value = count;
+        return true;
+    }
+#endif
+
+public:
+
+    static std::atomic<bool>& anyOpened() {
+        static std::atomic<bool> opened{false};
+        return opened;
+    }
+
+    static std::atomic<bool>& anyMapped() {
+        static std::atomic<bool> mapped{false};
+        return mapped;
+    }
+
+    CounterGroup() noexcept {
+        for (int m = 0; m < kMetricCount; ++m) {
+            fds[m] = -1;
+            slot[m] = -1;
+        }
+#if defined(__linux__)
+        static const std::uint64_t configs[kMetricCount] = { 0, PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+            PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES };
+        int next = 0;
+        for (int m = kCycles; m < kMetricCount; ++m) {
+            perf_event_attr attr;
+            std::memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = configs[m];
+            attr.read_format = PERF_FORMAT_GROUP;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            int fd = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, leader, 0));
+            if (fd < 0) {
+                if (leader < 0) {
+                    return; // Без лидера группы не будет: только время
+                }
+                continue;
+            }
+            if (leader < 0) {
+                leader = fd;
+            }
+            fds[m] = fd;
+            slot[m] = next++;
+#if PERF_REGIONS_X86
+            void* page = mmap(nullptr, static_cast<std::size_t>(sysconf(_SC_PAGESIZE)), PROT_READ, MAP_SHARED, fd, 0);
+            if (page != MAP_FAILED) {
+                pages[m] = static_cast<perf_event_mmap_page*>(page);
+                anyMapped().store(true, std::memory_order_relaxed);
+            }
+#endif
+        }
+        anyOpened().store(true, std::memory_order_relaxed);
+#endif
+    }
+
+    ~CounterGroup() {
+#if defined(__linux__)
+        for (int m = kCycles; m < kMetricCount; ++m) {
+            if (pages[m]) {
+                munmap(pages[m], static_cast<std::size_t>(sysconf(_SC_PAGESIZE)));
+            }
+            if (fds[m] >= 0) {
+                close(fds[m]);
+            }
+        }
+#endif
+    }
+
+    CounterGroup(const CounterGroup&) = delete;
+    CounterGroup& operator=(const CounterGroup&) = delete;
+
+    void read(Reading& reading) const noexcept {
+#if defined(__linux__)
+        if (leader < 0) {
+            return;
+        }
+#if PERF_REGIONS_X86
+        bool mapped = true;
+        for (int m = kCycles; m < kMetricCount && mapped; ++m) {
+            if (fds[m] >= 0) {
+                mapped = pages[m] && readMapped(pages[m], reading.values[m]);
+                reading.valid[m] = mapped;
+            }
+        }
+        if (mapped) {
+            return;
+        }
+#endif
+        std::uint64_t buffer[1 + kMetricCount] = {};
+        if (::read(leader, buffer, sizeof(buffer)) <= 0) {
+            return;
+        }
+        for (int m = kCycles; m < kMetricCount; ++m) {
+            if (slot[m] >= 0 && static_cast<std::uint64_t>(slot[m]) < buffer[0]) {
+                reading.values[m] = buffer[1 + slot[m]];
+                reading.valid[m] = true;
+            }
+        }
+#else
+        (void)reading;
+#endif
+    }
+};
+
+// Все области программы; общая статистика пополняется при завершении потоков,
+// при завершении программы пишется отчет
+class Registry {
+
+private:
+
+    struct Entry {
+        const char* name;
+        RegionStats* totals;
+    };
+
+    std::atomic_flag busy = ATOMIC_FLAG_INIT; // Короткие участки: регистрация и слияние
+    Entry entries[kMaxRegions] = {};
+    int count = 0;
+    bool closed = false;
+    std::uint64_t startTicks;
+    std::uint64_t startNs;
+    double ticksToNs = 1.0;
+
+    class Guard {
+
+    private:
+
+        std::atomic_flag& flag;
+
+    public:
+
+        explicit Guard(std::atomic_flag& f) noexcept : flag(f) {
+            while (flag.test_and_set(std::memory_order_acquire)) {
+                std::this_thread::yield();
+            }
+        }
+
+        ~Guard() { flag.clear(std::memory_order_release); }
+    };
+
+    // Частота TSC: такты против clock_gettime на отрезке около миллисекунды
+    Registry() noexcept : startTicks(clockTicks()), startNs(monotonicNs()) {
+#if PERF_REGIONS_X86
+        std::uint64_t ns = startNs;
+        while (ns - startNs < 1000000) {
+            ns = monotonicNs();
+        }
+        std::uint64_t ticks = clockTicks();
+        ticksToNs = ticks > startTicks ? static_cast<double>(ns - startNs) / static_cast<double>(ticks - startTicks) : 1.0;
+#endif
+    }
+
+    static void writeDistribution(std::FILE* out, const Distribution& d, std::uint64_t samples) {
+        int last = kBuckets - 1;
+        while (last > 0 && d.buckets[last] == 0) {
+            --last;
+        }
+        std::fprintf(out, "{\"total\": %llu, \"min\": %llu, \"max\": %llu, \"mean\": %.1f, \"histogram_log2\": [",
+            static_cast<unsigned long long>(d.total), static_cast<unsigned long long>(samples ? d.min : 0),
+            static_cast<unsigned long long>(d.max), samples ? static_cast<double>(d.total) / samples : 0.0);
+        for (int b = 0; b <= last; ++b) {
+            std::fprintf(out, "%s%llu", b ? ", " : "", static_cast<unsigned long long>(d.buckets[b]));
+        }
+        std::fprintf(out, "]}");
+    }
+
+    void writeJson() {
+        const char* path = std::getenv("PERF_REGIONS_FILE");
+        std::FILE* out = std::fopen(path ? path : "perf_regions.json", "w");
+        if (!out) {
+            return;
+        }
+        std::fprintf(out, "{\n  \"counters\": \"%s\",\n  \"clock\": \"%s\",\n  \"regions\": [",
+            !CounterGroup::anyOpened().load() ? "none" : CounterGroup::anyMapped().load() ? "perf_event rdpmc" : "perf_event read",
+            PERF_REGIONS_X86 ? "rdtsc" : "clock_gettime");
+        for (int r = 0; r < count; ++r) {
+            const RegionStats& region = *entries[r].totals;
+            std::fprintf(out, "%s\n    {\"name\": \"%s\", \"count\": %llu", r ? "," : "", entries[r].name,
+                static_cast<unsigned long long>(region.count));
+            for (int m = 0; m < kMetricCount; ++m) {
+                if (region.samples[m] > 0) {
+                    std::fprintf(out, ",\n     \"%s\": ", kMetricNames[m]);
+                    writeDistribution(out, region.metrics[m], region.samples[m]);
+                }
+            }
+            std::fprintf(out, "}");
+        }
+        std::fprintf(out, "\n  ]\n}\n");
+        std::fclose(out);
+    }
+
+public:
+
+    static Registry& instance() noexcept {
+        static Registry registry;
+        return registry;
+    }
+
+    ~Registry() {
+        Guard guard(busy);
+        closed = true;
+        writeJson();
+    }
+
+    double nsPerTick() const noexcept { return ticksToNs; }
+
+    // Номер области по имени (одно имя - одна область, даже из разных мест кода); -1, если мест нет.
+    // Имя должно жить до конца программы (строковый литерал)
+    int id(const char* name) noexcept {
+        Guard guard(busy);
+        for (int r = 0; r < count; ++r) {
+            if (std::strcmp(entries[r].name, name) == 0) {
+                return r;
+            }
+        }
+        if (count == kMaxRegions) {
+            return -1;
+        }
+        RegionStats* totals = new (std::nothrow) RegionStats;
+        if (!totals) {
+            return -1;
+        }
+        entries[count] = { name, totals };
+        return count++;
+    }
+
+    void merge(int region, const RegionStats& stats) noexcept {
+        Guard guard(busy);
+        if (!closed) {
+            entries[region].totals->merge(stats);
+        }
+    }
+
+    // Запись мимо статистики потока: из деструкторов thread_local-объектов после ThreadStats
+    void record(int region, const Reading& begin, const Reading& end) noexcept {
+        Guard guard(busy);
+        if (!closed) {
+            entries[region].totals->record(begin, end, ticksToNs);
+        }
+    }
+};
+
+// Счетчики и статистика областей текущего потока; при завершении потока сливаются в Registry
+class ThreadStats {
+
+private:
+
+    RegionStats* regions[kMaxRegions] = {}; // Создаются при первом входе потока в область
+    double nsPerTick = Registry::instance().nsPerTick();
+
+public:
+
+    CounterGroup group;
+
+    static bool& finished() noexcept {
+        thread_local bool done = false; // Тривиальный: доступен и после деструкторов потока
+        return done;
+    }
+
+    static ThreadStats* local() noexcept {
+        if (finished()) {
+            return nullptr;
+        }
+        thread_local ThreadStats stats;
+        return &stats;
+    }
+
+    ThreadStats() = default;
+
+    ThreadStats(const ThreadStats&) = delete;
+    ThreadStats& operator=(const ThreadStats&) = delete;
+
+    ~ThreadStats() {
+        for (int r = 0; r < kMaxRegions; ++r) {
+            if (regions[r]) {
+                Registry::instance().merge(r, *regions[r]);
+                delete regions[r];
+            }
+        }
+        finished() = true;
+    }
+
+    void record(int region, const Reading& begin, const Reading& end) noexcept {
+        RegionStats* stats = regions[region];
+        if (!stats) {
+            stats = regions[region] = new (std::nothrow) RegionStats;
+            if (!stats) {
+                return;
+            }
+        }
+        stats->record(begin, end, nsPerTick);
+    }
+};
+
+inline int region(const char* name) noexcept {
+    return Registry::instance().id(name);
+}
+
+inline Reading sample(const ThreadStats* thread) noexcept {
+    Reading reading;
+    if (thread) {
+        thread->group.read(reading);
+    }
+    reading.values[kNs] = clockTicks();
+    reading.valid[kNs] = true;
+    return reading;
+}
+
+// Замер от создания до уничтожения объекта
+class Scope {
+
+private:
+
+    int id;
+    ThreadStats* thread;
+    Reading begin;
+
+public:
+
+    explicit Scope(int regionId) noexcept : id(regionId), thread(id >= 0 ? ThreadStats::local() : nullptr) {
+        if (id >= 0) {
+            begin = sample(thread);
+        }
+    }
+
+    ~Scope() {
+        if (id < 0) {
+            return;
+        }
+        Reading end = sample(thread);
+        if (thread && !ThreadStats::finished()) {
+            thread->record(id, begin, end);
+        }
+        else {
+            Registry::instance().record(id, begin, end);
+        }
+    }
+
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+};
+
+template <class F>
+decltype(auto) measure(int regionId, F&& f) {
+    Scope scope(regionId);
+    return f();
+}
+
+} // namespace perf_regions
+
+#define PERF_REGIONS_CAT2(a, b) a##b
+#define PERF_REGIONS_CAT(a, b) PERF_REGIONS_CAT2(a, b)
+
+#define PERF_REGION(name)                                                                                        \
+    static const int PERF_REGIONS_CAT(perf_region_id_, __LINE__) = ::perf_regions::region(name);               \
+    ::perf_regions::Scope PERF_REGIONS_CAT(perf_region_scope_, __LINE__)(PERF_REGIONS_CAT(perf_region_id_, __LINE__))
+
+#define PERF_REGION_EXPR(name, expr)                                                                             \
+    ::perf_regions::measure([]() noexcept { static const int id = ::perf_regions::region(name); return id; }(), \
+        [&]() -> decltype(auto) { return (expr); })
+
+#else
+
+#define PERF_REGION(name) static_cast<void>(0)
+#define PERF_REGION_EXPR(name, expr) (expr)
+
+#endif
@@ -1,7 +1,71 @@
 #include <iostream>
+#include <string>
+#include <vector>
+#include <optional>
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <cstring>
+#include <cmath>
+#include <queue>
+#include <functional>
+#include <fstream>
+#include <sstream>
+#include <charconv>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <numeric>
+#include <atomic>
+
+#if defined(OOP2_USE_PSTL)
+#include <execution>
+#endif
+
+#include "Common/AllocHooks.h"
+#include "Common/Bench.h"
+#include "Common/LifecycleTrace.h"
+#include "Common/PerfRegions.h"
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Набор команд для пакетных операций PointSoA/CircleSoA
+#if !defined(OOP2_SOA_SCALAR)
+#if defined(__AVX2__)
+#define OOP2_SOA_AVX2
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define OOP2_SOA_SSE2
+#include <emmintrin.h>
+#if defined(__SSE4_1__)
+#define OOP2_SOA_SSE41
+#include <smmintrin.h>
+#endif
+#endif
+#endif
 
 using namespace std;
 
+// Счетчики копирований и перемещений фигур в текущем потоке (для проверки контейнеров)
+struct CopyMoveStats {
+
+    uint64_t copies = 0;
+    uint64_t moves = 0;
+
+};
+
+inline thread_local CopyMoveStats copyMoveStats;
+
 // Базовый класс Point
 class Point {
 
@@ -11,13 +75,15 @@ protected:
 
 public:
 
+    ALLOC_PROFILE_TYPE("Point") // Учет живых объектов при сборке с -DALLOC_PROFILE=1
+
     // Конструктор по умолчанию
     Point() {
 
         this->x = 0;
         this->y = 0;
 
-        cout << "Конструктор Point()" << endl; // Вывод сообщения о создании объекта
+        LIFECYCLE_TRACE("Конструктор Point()"); // Вывод сообщения о создании объекта
 
     }
 
@@ -27,14 +93,14 @@ public:
         this->x = x;
         this->y = y;
 
-        cout << "Конструктор Point(" << x << ", " << y << ")" << endl; // Вывод сообщения о создании объекта с параметрами
+        LIFECYCLE_TRACE("Конструктор Point(" << x << ", " << y << ")"); // Вывод сообщения о создании объекта с параметрами
 
     }
 
     // Виртуальный деструктор для правильного удаления наследников
     virtual ~Point() {
 
-        cout << "Деструктор ~Point() для точки (" << x << ", " << y << ")" << endl; // Вывод сообщения о разрушении объекта
+        LIFECYCLE_TRACE("Деструктор ~Point() для точки (" << x << ", " << y << ")"); // Вывод сообщения о разрушении объекта
 
     }
 
@@ -45,6 +111,45 @@ public:
 
     }
 
+    // Сдвиг точки на вектор (dx, dy)
+    virtual void translate(int dx, int dy) {
+
+        x += dx;
+        y += dy;
+
+    }
+
+    // Масштабирование координат относительно начала координат
+    virtual void scale(double factor) {
+
+        x = static_cast<int>(x * factor);
+        y = static_cast<int>(y * factor);
+
+    }
+
+    // Проверка попадания точки (px, py) в фигуру
+    virtual bool contains(int px, int py) const {
+
+        return px == x && py == y;
+
+    }
+
+    // Площадь фигуры (у точки нулевая)
+    virtual double area() const {
+
+        return 0.0;
+
+    }
+
+    // Запись в двоичный буфер: тег 'P' и координаты
+    virtual void serialize(string& out) const {
+
+        out.push_back('P');
+        appendRaw(out, x);
+        appendRaw(out, y);
+
+    }
+
     // Геттеры для доступа к защищенным полям
 
     int getX() const { 
@@ -59,13 +164,28 @@ public:
 
     } 
 
+protected:
+
+    // Дописывает байты значения в буфер
+    template <class T>
+    static void appendRaw(string& out, const T& value) {
+
+        char bytes[sizeof(T)];
+        memcpy(bytes, &value, sizeof(T));
+        out.append(bytes, sizeof(T));
+
+    }
+
+public:
+
     // Конструктор копирования
     Point(const Point& other) {
 
         x = other.x;
         y = other.y;
 
-        cout << "Конструктор копирования Point" << endl; // Вывод сообщения о копировании
+        ++copyMoveStats.copies;
+        LIFECYCLE_TRACE("Конструктор копирования Point"); // Вывод сообщения о копировании
 
     }
 
@@ -82,7 +202,32 @@ public:
         x = other.x;
         y = other.y;
 
-        cout << "Оператор присваивания Point" << endl; // Вывод сообщения о присваивании
+        ++copyMoveStats.copies;
+        LIFECYCLE_TRACE("Оператор присваивания Point"); // Вывод сообщения о присваивании
+
+        return *this; // Возврат ссылки на текущий объект
+
+    }
+
+    // Конструктор перемещения
+    Point(Point&& other) noexcept {
+
+        x = other.x;
+        y = other.y;
+
+        ++copyMoveStats.moves;
+        LIFECYCLE_TRACE("Конструктор перемещения Point"); // Вывод сообщения о перемещении
+
+    }
+
+    // Оператор присваивания перемещением
+    Point& operator=(Point&& other) noexcept {
+
+        x = other.x;
+        y = other.y;
+
+        ++copyMoveStats.moves;
+        LIFECYCLE_TRACE("Оператор присваивания перемещением Point"); // Вывод сообщения о перемещении
 
         return *this; // Возврат ссылки на текущий объект
 
@@ -98,12 +243,14 @@ private:
 
 public:
 
+    ALLOC_PROFILE_TYPE("Circle")
+
     // Конструктор по умолчанию
     Circle() : Point() { 
 
         this->radius = 1.0;
 
-        cout << "Конструктор Circle(), радиус = " << radius << endl; // Вывод сообщения о создании объекта
+        LIFECYCLE_TRACE("Конструктор Circle(), радиус = " << radius); // Вывод сообщения о создании объекта
 
     }
 
@@ -112,14 +259,14 @@ public:
 
         radius = r;
 
-        cout << "Конструктор Circle(" << x << ", " << y << ", " << r << ")" << endl; // Вывод сообщения о создании объекта с параметрами
+        LIFECYCLE_TRACE("Конструктор Circle(" << x << ", " << y << ", " << r << ")"); // Вывод сообщения о создании объекта с параметрами
 
     }
 
     // Деструктор
     ~Circle() override {
 
-        cout << "Деструктор ~Circle(), радиус = " << radius << endl; // Вывод сообщения о разрушении объекта
+        LIFECYCLE_TRACE("Деструктор ~Circle(), радиус = " << radius); // Вывод сообщения о разрушении объекта
 
     }
 
@@ -130,6 +277,47 @@ public:
 
     }
 
+    // Масштабирование центра и радиуса
+    void scale(double factor) override {
+
+        Point::scale(factor);
+        radius *= factor;
+
+    }
+
+    // Точка внутри круга или на его границе
+    bool contains(int px, int py) const override {
+
+        double dx = static_cast<double>(px) - x;
+        double dy = static_cast<double>(py) - y;
+
+        return dx * dx + dy * dy <= radius * radius;
+
+    }
+
+    // Площадь круга
+    double area() const override {
+
+        return 3.14159265358979323846 * radius * radius;
+
+    }
+
+    // Запись в двоичный буфер: тег 'C', центр и радиус
+    void serialize(string& out) const override {
+
+        out.push_back('C');
+        appendRaw(out, x);
+        appendRaw(out, y);
+        appendRaw(out, radius);
+
+    }
+
+    double getRadius() const {
+
+        return radius; // Возвращает радиус
+
+    }
+
     // Пример protected-метода в классе-наследнике
 protected:
 
@@ -146,7 +334,8 @@ public:
 
         radius = other.radius;
 
-        cout << "Конструктор копирования Circle" << endl; // Вывод сообщения о копировании
+        ++copyMoveStats.copies;
+        LIFECYCLE_TRACE("Конструктор копирования Circle"); // Вывод сообщения о копировании
 
     }
 
@@ -162,7 +351,31 @@ public:
         Point::operator=(other); // Вызов оператора присваивания базового класса
         radius = other.radius;
 
-        cout << "Оператор присваивания Circle" << endl; // Вывод сообщения о присваивании
+        ++copyMoveStats.copies;
+        LIFECYCLE_TRACE("Оператор присваивания Circle"); // Вывод сообщения о присваивании
+
+        return *this; // Возврат ссылки на текущий объект
+
+    }
+
+    // Конструктор перемещения
+    Circle(Circle&& other) noexcept : Point(std::move(other)) {
+
+        radius = other.radius;
+
+        ++copyMoveStats.moves;
+        LIFECYCLE_TRACE("Конструктор перемещения Circle"); // Вывод сообщения о перемещении
+
+    }
+
+    // Оператор присваивания перемещением
+    Circle& operator=(Circle&& other) noexcept {
+
+        Point::operator=(std::move(other)); // Перемещение базовой части
+        radius = other.radius;
+
+        ++copyMoveStats.moves;
+        LIFECYCLE_TRACE("Оператор присваивания перемещением Circle"); // Вывод сообщения о перемещении
 
         return *this; // Возврат ссылки на текущий объект
 
@@ -184,14 +397,14 @@ public:
         topLeft = Point(x1, y1);
         bottomRight = Point(x2, y2);
 
-        cout << "Конструктор Rectangle(" << x1 << ", " << y1 << ", " << x2 << ", " << y2 << ")" << endl; // Вывод сообщения о создании объекта
+        LIFECYCLE_TRACE("Конструктор Rectangle(" << x1 << ", " << y1 << ", " << x2 << ", " << y2 << ")"); // Вывод сообщения о создании объекта
 
     }
 
     // Деструктор
     ~Rectangle() {
 
-        cout << "Деструктор ~Rectangle()" << endl; // Вывод сообщения о разрушении объекта
+        LIFECYCLE_TRACE("Деструктор ~Rectangle()"); // Вывод сообщения о разрушении объекта
 
     }
 
@@ -209,19 +422,62 @@ public:
 
     }
 
+    // Углы прямоугольника
+    const Point& getTopLeft() const {
+
+        return topLeft;
+
+    }
+
+    const Point& getBottomRight() const {
+
+        return bottomRight;
+
+    }
+
+    // Упорядочивает углы: левый верхний получает меньшие координаты
+    void normalize() {
+
+        int x1 = topLeft.getX(), y1 = topLeft.getY();
+        int x2 = bottomRight.getX(), y2 = bottomRight.getY();
+        if (x1 > x2 || y1 > y2) {
+            topLeft = Point(min(x1, x2), min(y1, y2));
+            bottomRight = Point(max(x1, x2), max(y1, y2));
+        }
+
+    }
+
+    // Площадь (углы могут быть в любом порядке)
+    double area() const {
+
+        return fabs(static_cast<double>(bottomRight.getX() - topLeft.getX())) * fabs(static_cast<double>(bottomRight.getY() - topLeft.getY()));
+
+    }
+
+    // Пересекается ли с другим прямоугольником (оба нормализованы; касание считается пересечением)
+    bool overlaps(const Rectangle& other) const {
+
+        return topLeft.getX() <= other.bottomRight.getX() && other.topLeft.getX() <= bottomRight.getX()
+            && topLeft.getY() <= other.bottomRight.getY() && other.topLeft.getY() <= bottomRight.getY();
+
+    }
+
     // Конструктор копирования
     Rectangle(const Rectangle& other) {
 
         topLeft = other.topLeft;
         bottomRight = other.bottomRight;
 
-        cout << "Конструктор копирования Rectangle" << endl; // Вывод сообщения о копировании
+        ++copyMoveStats.copies;
+        LIFECYCLE_TRACE("Конструктор копирования Rectangle"); // Вывод сообщения о копировании
 
     }
 
     // Оператор присваивания
     Rectangle& operator=(const Rectangle& other) {
 
+        PERF_REGION("OOP2/Rectangle::operator=");
+
         if (this == &other) {
 
             return *this; // Проверка на самоприсваивание
@@ -231,46 +487,232 @@ public:
         topLeft = other.topLeft;
         bottomRight = other.bottomRight;
 
-        cout << "Оператор присваивания Rectangle" << endl; // Вывод сообщения о присваивании
+        ++copyMoveStats.copies;
+        LIFECYCLE_TRACE("Оператор присваивания Rectangle"); // Вывод сообщения о присваивании
+
+        return *this; // Возврат ссылки на текущий объект
+
+    }
+
+    // Конструктор перемещения
+    Rectangle(Rectangle&& other) noexcept : topLeft(std::move(other.topLeft)), bottomRight(std::move(other.bottomRight)) {
+
+        ++copyMoveStats.moves;
+        LIFECYCLE_TRACE("Конструктор перемещения Rectangle"); // Вывод сообщения о перемещении
+
+    }
+
+    // Оператор присваивания перемещением
+    Rectangle& operator=(Rectangle&& other) noexcept {
+
+        topLeft = std::move(other.topLeft);
+        bottomRight = std::move(other.bottomRight);
+
+        ++copyMoveStats.moves;
+        LIFECYCLE_TRACE("Оператор присваивания перемещением Rectangle"); // Вывод сообщения о перемещении
 
         return *this; // Возврат ссылки на текущий объект
 
     }
 };
 
-// Класс RectanglePtr с использованием указателей
-class RectanglePtr {
+// Пул блоков фиксированного размера под объекты Point.
+// Память берется у кучи крупными кусками, освобожденные блоки попадают в список свободных
+// и переиспользуются без обращения к куче
+class PointPool {
+
+private:
+
+    union Slot {
+        Slot* next; // Следующий свободный блок
+        alignas(Point) unsigned char storage[sizeof(Point)];
+    };
+
+    vector<unique_ptr<Slot[]>> chunks; // Выделенные куски
+    Slot* freeList = nullptr; // Голова списка свободных блоков
+    size_t slotsPerChunk;
+    size_t live = 0; // Занятых блоков
+
+public:
+
+    explicit PointPool(size_t slotsPerChunk = 1024) : slotsPerChunk(slotsPerChunk) {}
+
+    PointPool(const PointPool&) = delete;
+    PointPool& operator=(const PointPool&) = delete;
+
+    void* allocate() {
+
+        if (!freeList) {
+            chunks.push_back(make_unique<Slot[]>(slotsPerChunk));
+            Slot* chunk = chunks.back().get();
+            for (size_t i = 0; i < slotsPerChunk; ++i) {
+                chunk[i].next = freeList;
+                freeList = &chunk[i];
+            }
+        }
+
+        Slot* slot = freeList;
+        freeList = slot->next;
+        ++live;
+
+        return slot;
+
+    }
+
+    void deallocate(void* p) {
+
+        Slot* slot = static_cast<Slot*>(p);
+        slot->next = freeList;
+        freeList = slot;
+        --live;
+
+    }
+
+    size_t liveCount() const { return live; }
+    size_t capacity() const { return chunks.size() * slotsPerChunk; }
+};
+
+// Монотонная арена: выделение - сдвиг указателя, освобождение только всей арены сразу (reset).
+// Деструкторы объектов вызывает владелец, арена лишь возвращает память
+class PointArena {
+
+private:
+
+    static constexpr size_t kSlot = (sizeof(Point) + alignof(Point) - 1) / alignof(Point) * alignof(Point);
+
+    vector<unique_ptr<unsigned char[]>> blocks; // Выделенные блоки
+    size_t slotsPerBlock;
+    size_t used = 0; // Занято ячеек в текущем блоке
+    size_t current = 0; // Номер текущего блока
+
+public:
+
+    explicit PointArena(size_t slotsPerBlock = 4096) : slotsPerBlock(slotsPerBlock) {}
+
+    PointArena(const PointArena&) = delete;
+    PointArena& operator=(const PointArena&) = delete;
+
+    void* allocate() {
+
+        if (blocks.empty() || used == slotsPerBlock) {
+            if (!blocks.empty()) {
+                ++current;
+            }
+            if (current == blocks.size()) {
+                blocks.push_back(unique_ptr<unsigned char[]>(new unsigned char[kSlot * slotsPerBlock]));
+            }
+            used = 0;
+        }
+
+        return blocks[current].get() + kSlot * used++;
+
+    }
+
+    void deallocate(void*) {} // Память вернется при reset()
+
+    // Все объекты в арене должны быть уже разрушены; блоки остаются для повторного использования
+    void reset() {
+
+        used = 0;
+        current = 0;
+
+    }
+
+    size_t capacity() const { return blocks.size() * slotsPerBlock; }
+};
+
+// Распределители узлов Point для BasicRectanglePtr. Требования к типу распределителя:
+//   Point* create(int x, int y), Point* clone(const Point&), void destroy(Point*) (nullptr допустим),
+//   operator== (равные распределители могут освобождать точки друг друга);
+//   копия распределителя работает с тем же источником памяти
+
+// Обычная куча: new/delete
+struct HeapPointAllocator {
+
+    Point* create(int x, int y) const { return new Point(x, y); }
+
+    Point* clone(const Point& p) const { return new Point(p); }
+
+    void destroy(Point* p) const { delete p; }
+
+    bool operator==(const HeapPointAllocator&) const { return true; }
+};
+
+// Размещение в пуле или арене (Resource::allocate/deallocate)
+template <class Resource>
+class ResourcePointAllocator {
+
+private:
+
+    Resource* resource;
+
+public:
+
+    explicit ResourcePointAllocator(Resource& r) : resource(&r) {}
+
+    Point* create(int x, int y) const { return new (resource->allocate()) Point(x, y); }
+
+    Point* clone(const Point& p) const { return new (resource->allocate()) Point(p); }
+
+    void destroy(Point* p) const {
+
+        if (p) {
+            p->~Point();
+            resource->deallocate(p);
+        }
+
+    }
+
+    // Точки, выделенные одним распределителем, может освобождать другой
+    bool operator==(const ResourcePointAllocator& other) const { return resource == other.resource; }
+};
+
+using PoolPointAllocator = ResourcePointAllocator<PointPool>;
+using ArenaPointAllocator = ResourcePointAllocator<PointArena>;
+
+// Класс RectanglePtr с использованием указателей.
+// Точки размещаются через распределитель PointAllocator (по умолчанию - обычная куча)
+template <class PointAllocator = HeapPointAllocator>
+class BasicRectanglePtr {
 
 private:
 
+    PointAllocator allocator; // Источник памяти для точек
     Point* topLeft; // Указатель на левую верхнюю точку
     Point* bottomRight; // Указатель на правую нижнюю точку
 
 public:
 
     // Конструктор с параметрами
-    RectanglePtr(int x1, int y1, int x2, int y2) {
+    BasicRectanglePtr(int x1, int y1, int x2, int y2, PointAllocator alloc = PointAllocator()) : allocator(alloc) {
 
-        topLeft = new Point(x1, y1); // Выделение памяти для левой верхней точки
-        bottomRight = new Point(x2, y2); // Выделение памяти для правой нижней точки
+        topLeft = allocator.create(x1, y1); // Выделение памяти для левой верхней точки
+        bottomRight = allocator.create(x2, y2); // Выделение памяти для правой нижней точки
 
-        cout << "Конструктор RectanglePtr(" << x1 << ", " << y1 << ", " << x2 << ", " << y2 << ")" << endl; // Вывод сообщения о создании объекта
+        LIFECYCLE_TRACE("Конструктор RectanglePtr(" << x1 << ", " << y1 << ", " << x2 << ", " << y2 << ")"); // Вывод сообщения о создании объекта
 
     }
 
     // Деструктор
-    ~RectanglePtr() {
+    ~BasicRectanglePtr() {
 
-        cout << "Деструктор ~RectanglePtr()" << endl; // Вывод сообщения о разрушении объекта
+        LIFECYCLE_TRACE("Деструктор ~RectanglePtr()"); // Вывод сообщения о разрушении объекта
 
-        delete topLeft; // Освобождение памяти
-        delete bottomRight; // Освобождение памяти
+        allocator.destroy(topLeft); // Освобождение памяти
+        allocator.destroy(bottomRight); // Освобождение памяти
 
     }
 
     // Метод для вывода информации о прямоугольнике
     void print() const {
 
+        if (!topLeft) {
+
+            cout << "Прямоугольник (указатели): перемещен" << endl; // Точки забрал другой объект
+            return;
+
+        }
+
         cout << "Прямоугольник (указатели):" << endl;
         cout << " Левый верхний ";
 
@@ -282,18 +724,33 @@ public:
 
     }
 
-    // Конструктор копирования с глубоким копированием
-    RectanglePtr(const RectanglePtr& other) {
+    // Углы прямоугольника (у перемещенного объекта вызывать нельзя)
+    const Point& getTopLeft() const {
+
+        return *topLeft;
+
+    }
+
+    const Point& getBottomRight() const {
+
+        return *bottomRight;
+
+    }
+
+    // Конструктор копирования с глубоким копированием (в том же источнике памяти)
+    BasicRectanglePtr(const BasicRectanglePtr& other) : allocator(other.allocator) {
 
-        topLeft = new Point(*other.topLeft); // Создание новой точки для левой верхней
-        bottomRight = new Point(*other.bottomRight); // Создание новой точки для правой нижней
+        PERF_REGION("OOP2/RectanglePtr copy");
+        topLeft = other.topLeft ? allocator.clone(*other.topLeft) : nullptr; // Создание новой точки для левой верхней
+        bottomRight = other.bottomRight ? allocator.clone(*other.bottomRight) : nullptr; // Создание новой точки для правой нижней
 
-        cout << "Конструктор копирования RectanglePtr" << endl; // Вывод сообщения о копировании
+        ++copyMoveStats.copies;
+        LIFECYCLE_TRACE("Конструктор копирования RectanglePtr"); // Вывод сообщения о копировании
 
     }
 
-    // Оператор присваивания с глубоким копированием
-    RectanglePtr& operator=(const RectanglePtr& other) {
+    // Оператор присваивания с глубоким копированием: уже выделенные точки переиспользуются
+    BasicRectanglePtr& operator=(const BasicRectanglePtr& other) {
 
         if (this == &other) { 
 
@@ -301,114 +758,3271 @@ public:
 
         }
 
-        delete topLeft; // Освобождение старой памяти
-        delete bottomRight; // Освобождение старой памяти
-
-        topLeft = new Point(*other.topLeft); // Создание новой точки для левой верхней
-        bottomRight = new Point(*other.bottomRight); // Создание новой точки для правой нижней
+        assignCorner(topLeft, other.topLeft); // Копирование значения в существующую точку
+        assignCorner(bottomRight, other.bottomRight);
 
-        cout << "Оператор присваивания RectanglePtr" << endl; // Вывод сообщения о присваивании
+        ++copyMoveStats.copies;
+        LIFECYCLE_TRACE("Оператор присваивания RectanglePtr"); // Вывод сообщения о присваивании
 
         return *this; // Возврат ссылки на текущий объект
 
     }
-};
-
-int main() {
 
-    setlocale(LC_ALL, "RU"); // Установка локали для корректного вывода русских символов
+    // Конструктор перемещения: точки забираются у other без выделения памяти
+    BasicRectanglePtr(BasicRectanglePtr&& other) noexcept
+        : allocator(other.allocator), topLeft(other.topLeft), bottomRight(other.bottomRight) {
 
-    int choice;
+        other.topLeft = nullptr;
+        other.bottomRight = nullptr;
 
-    while (true) {
-        cout << "Выберите пример для выполнения(1 - 5, 0 для выхода) : " << endl << endl;
+        ++copyMoveStats.moves;
+        LIFECYCLE_TRACE("Конструктор перемещения RectanglePtr"); // Вывод сообщения о перемещении
 
-        cin >> choice;
+    }
 
-        switch (choice) {
+    // Оператор присваивания перемещением
+    BasicRectanglePtr& operator=(BasicRectanglePtr&& other) noexcept {
 
-        case 0: {
+        if (this == &other) {
 
-            return 0;
+            return *this; // Проверка на самоприсваивание
 
         }
 
-        case 1: {
-            cout << "Статическое создание объектов" << endl << endl;
+        if (allocator == other.allocator) {
+
+            allocator.destroy(topLeft); // Свои точки больше не нужны
+            allocator.destroy(bottomRight);
 
-            // Создание объекта класса Point
-            Point point(10, 20);
-            point.print();
-            cout << endl;
+            topLeft = other.topLeft; // Забираем точки other
+            bottomRight = other.bottomRight;
+            other.topLeft = nullptr;
+            other.bottomRight = nullptr;
 
-            break;
+        }
+        else {
+
+            // Разные источники памяти: чужие точки освобождать нельзя, копируем значения
+            assignCorner(topLeft, other.topLeft);
+            assignCorner(bottomRight, other.bottomRight);
 
         }
 
-        case 2: {
+        ++copyMoveStats.moves;
+        LIFECYCLE_TRACE("Оператор присваивания перемещением RectanglePtr"); // Вывод сообщения о перемещении
+
+        return *this; // Возврат ссылки на текущий объект
+
+    }
 
-            cout << "Динамическое создание объектов" << endl << endl;
+private:
 
-            // Динамическое создание объекта класса Circle
-            Circle* circle = new Circle(30, 40, 5.5);
-            circle->print();
-            cout << endl;
+    // Копирует значение угла, переиспользуя уже выделенную точку
+    void assignCorner(Point*& mine, const Point* theirs) {
 
-            delete circle;
+        if (!theirs) {
 
-            break;
+            allocator.destroy(mine);
+            mine = nullptr;
 
         }
+        else if (mine) {
 
-        case 3: {
+            *mine = *theirs;
 
-            cout << "Присваивание значения объектов" << endl << endl;
+        }
+        else {
 
-            // Rectangle
-            Rectangle rectangle1(0, 0, 1, 1); // Создаем объект с временными значениями
-            Rectangle rectangle2(5, 5, 25, 25); // Создаем временный объект
-            rectangle1 = rectangle2; // Присваиваем значение
-            rectangle1.print();
-            cout << endl;
+            mine = allocator.clone(*theirs);
 
-            break;
         }
 
-        case 4: {
+    }
+};
 
-            cout << "Полиморфизм объектов" << endl << endl;
+using RectanglePtr = BasicRectanglePtr<>;
 
+// Перемещения не бросают исключений, поэтому vector при росте перемещает элементы, а не копирует
+static_assert(is_nothrow_move_constructible<Point>::value && is_nothrow_move_assignable<Point>::value, "Point");
+static_assert(is_nothrow_move_constructible<Circle>::value && is_nothrow_move_assignable<Circle>::value, "Circle");
+static_assert(is_nothrow_move_constructible<Rectangle>::value && is_nothrow_move_assignable<Rectangle>::value, "Rectangle");
+static_assert(is_nothrow_move_constructible<RectanglePtr>::value && is_nothrow_move_assignable<RectanglePtr>::value, "RectanglePtr");
 
-            // Указатель на базовый класс указывает на объект производного класса
-            Point* ptr = new Circle(7, 8, 9.9);
+// Прямоугольник с копированием при записи. Копии делят один блок углов со счетчиком ссылок,
+// а собственный блок объект получает только при первом изменении. Общий блок не меняется,
+// поэтому копии можно читать из разных потоков одновременно; сам объект, как и любое значение,
+// нельзя одновременно менять из одного потока и читать из другого
+class CowRectangle {
 
-            // Вызов метода print() производного класса благодаря полиморфизму
-            ptr->print();
-            cout << endl;
+private:
 
-            // Освобождение памяти
-            delete ptr;
+    struct Corners {
 
-            break;
-        }
+        atomic<uint32_t> refs{ 1 };
+        Point topLeft;
+        Point bottomRight;
 
-        case 5: {
+        Corners(int x1, int y1, int x2, int y2) : topLeft(x1, y1), bottomRight(x2, y2) {}
 
-            cout << "Конструктор копирования объектов" << endl << endl;
+        Corners(const Corners& other) : topLeft(other.topLeft), bottomRight(other.bottomRight) {}
+    };
 
-            RectanglePtr rp1(1, 2, 3, 4);
-            RectanglePtr rp2 = rp1; // Использование конструктора копирования
-            rp1.print();
-            rp2.print();
-            cout << endl;
+    Corners* corners; // nullptr у перемещенного объекта
 
+    static void release(Corners* c) {
+
+        if (c && c->refs.fetch_sub(1, memory_order_acq_rel) == 1) {
+            delete c;
         }
 
-        default: {
-            cout << "Неверный выбор. Попробуйте снова." << endl;
-            break;
+    }
+
+    // Блок для записи: общий блок сначала копируется
+    Corners& writableCorners() {
+
+        if (!corners) {
+            corners = new Corners(0, 0, 0, 0);
+        }
+        else if (corners->refs.load(memory_order_acquire) != 1) {
+            Corners* own = new Corners(*corners);
+            release(corners);
+            corners = own;
+            LIFECYCLE_TRACE("Копирование углов CowRectangle при записи"); // Вывод сообщения о разделении
+        }
+
+        return *corners;
+
+    }
+
+public:
+
+    // Конструктор с параметрами
+    CowRectangle(int x1, int y1, int x2, int y2) : corners(new Corners(x1, y1, x2, y2)) {
+
+        LIFECYCLE_TRACE("Конструктор CowRectangle(" << x1 << ", " << y1 << ", " << x2 << ", " << y2 << ")"); // Вывод сообщения о создании объекта
+
+    }
+
+    // Деструктор
+    ~CowRectangle() {
+
+        LIFECYCLE_TRACE("Деструктор ~CowRectangle()"); // Вывод сообщения о разрушении объекта
+        release(corners);
+
+    }
+
+    // Метод для вывода информации о прямоугольнике
+    void print() const {
+
+        if (!corners) {
+            cout << "Прямоугольник (копирование при записи): перемещен" << endl;
+            return;
         }
 
+        cout << "Прямоугольник (копирование при записи):" << endl;
+        cout << " Левый верхний ";
+        corners->topLeft.print();
+        cout << " Правый нижний ";
+        corners->bottomRight.print();
+
+    }
+
+    // Углы прямоугольника (у перемещенного объекта вызывать нельзя)
+    const Point& getTopLeft() const {
+
+        return corners->topLeft;
+
+    }
+
+    const Point& getBottomRight() const {
+
+        return corners->bottomRight;
+
+    }
+
+    // Изменение углов: первая запись в общий блок делает свою копию
+    void setTopLeft(int x, int y) {
+
+        writableCorners().topLeft = Point(x, y);
+
+    }
+
+    void setBottomRight(int x, int y) {
+
+        writableCorners().bottomRight = Point(x, y);
+
+    }
+
+    // Сколько объектов делят блок углов (0 у перемещенного)
+    uint32_t useCount() const {
+
+        return corners ? corners->refs.load(memory_order_relaxed) : 0;
+
+    }
+
+    bool sharesWith(const CowRectangle& other) const {
+
+        return corners && corners == other.corners;
+
+    }
+
+    // Конструктор копирования: блок углов общий, памяти не выделяется
+    CowRectangle(const CowRectangle& other) : corners(other.corners) {
+
+        if (corners) {
+            corners->refs.fetch_add(1, memory_order_relaxed);
+        }
+        ++copyMoveStats.copies;
+
+        LIFECYCLE_TRACE("Конструктор копирования CowRectangle (углы общие)"); // Вывод сообщения о копировании
+
+    }
+
+    // Оператор присваивания: тоже только меняет ссылку на блок
+    CowRectangle& operator=(const CowRectangle& other) {
+
+        if (corners == other.corners) {
+            return *this; // Самоприсваивание или уже общий блок
+        }
+
+        if (other.corners) {
+            other.corners->refs.fetch_add(1, memory_order_relaxed);
+        }
+        release(corners);
+        corners = other.corners;
+        ++copyMoveStats.copies;
+
+        LIFECYCLE_TRACE("Оператор присваивания CowRectangle (углы общие)"); // Вывод сообщения о присваивании
+
+        return *this; // Возврат ссылки на текущий объект
+
+    }
+
+    // Конструктор перемещения
+    CowRectangle(CowRectangle&& other) noexcept : corners(other.corners) {
+
+        other.corners = nullptr;
+        ++copyMoveStats.moves;
+
+        LIFECYCLE_TRACE("Конструктор перемещения CowRectangle"); // Вывод сообщения о перемещении
+
+    }
+
+    // Оператор присваивания перемещением
+    CowRectangle& operator=(CowRectangle&& other) noexcept {
+
+        if (this == &other) {
+            return *this; // Проверка на самоприсваивание
+        }
+
+        release(corners);
+        corners = other.corners;
+        other.corners = nullptr;
+        ++copyMoveStats.moves;
+
+        LIFECYCLE_TRACE("Оператор присваивания перемещением CowRectangle"); // Вывод сообщения о перемещении
+
+        return *this; // Возврат ссылки на текущий объект
+
+    }
+};
+
+static_assert(is_nothrow_move_constructible<CowRectangle>::value && is_nothrow_move_assignable<CowRectangle>::value, "CowRectangle");
+
+// Ядра пакетных операций над массивами координат.
+// Векторная версия выбирается при компиляции (-mavx2 включает AVX2, на x86-64 всегда есть SSE2);
+// OOP2_SOA_SCALAR принудительно оставляет только скалярный путь.
+namespace soa_kernels {
+
+    // Сдвиг всех значений массива на d
+    inline void translate(int* a, size_t n, int d) {
+
+        size_t i = 0;
+
+#if defined(OOP2_SOA_AVX2)
+        __m256i vd = _mm256_set1_epi32(d);
+        for (; i + 8 <= n; i += 8) {
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(a + i), _mm256_add_epi32(v, vd));
+        }
+#elif defined(OOP2_SOA_SSE2)
+        __m128i vd = _mm_set1_epi32(d);
+        for (; i + 4 <= n; i += 4) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(a + i), _mm_add_epi32(v, vd));
+        }
+#endif
+
+        for (; i < n; ++i) {
+            a[i] += d;
+        }
+
+    }
+
+    // Масштабирование целых координат с отбрасыванием дробной части (как Point::scale)
+    inline void scale(int* a, size_t n, double k) {
+
+        size_t i = 0;
+
+#if defined(OOP2_SOA_AVX2)
+        __m256d vk = _mm256_set1_pd(k);
+        for (; i + 4 <= n; i += 4) {
+            __m256d v = _mm256_cvtepi32_pd(_mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i)));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(a + i), _mm256_cvttpd_epi32(_mm256_mul_pd(v, vk)));
+        }
+#elif defined(OOP2_SOA_SSE2)
+        __m128d vk = _mm_set1_pd(k);
+        for (; i + 2 <= n; i += 2) {
+            __m128d v = _mm_cvtepi32_pd(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(a + i)));
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(a + i), _mm_cvttpd_epi32(_mm_mul_pd(v, vk)));
+        }
+#endif
+
+        for (; i < n; ++i) {
+            a[i] = static_cast<int>(a[i] * k);
+        }
+
+    }
+
+    // Масштабирование радиусов
+    inline void scale(double* a, size_t n, double k) {
+
+        size_t i = 0;
+
+#if defined(OOP2_SOA_AVX2)
+        __m256d vk = _mm256_set1_pd(k);
+        for (; i + 4 <= n; i += 4) {
+            _mm256_storeu_pd(a + i, _mm256_mul_pd(_mm256_loadu_pd(a + i), vk));
+        }
+#elif defined(OOP2_SOA_SSE2)
+        __m128d vk = _mm_set1_pd(k);
+        for (; i + 2 <= n; i += 2) {
+            _mm_storeu_pd(a + i, _mm_mul_pd(_mm_loadu_pd(a + i), vk));
+        }
+#endif
+
+        for (; i < n; ++i) {
+            a[i] *= k;
+        }
+
+    }
+
+    // Минимум и максимум массива (n > 0)
+    inline void minMax(const int* a, size_t n, int& mn, int& mx) {
+
+        size_t i = 0;
+        mn = a[0];
+        mx = a[0];
+
+#if defined(OOP2_SOA_AVX2)
+        if (n >= 8) {
+            __m256i vmin = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a));
+            __m256i vmax = vmin;
+            for (i = 8; i + 8 <= n; i += 8) {
+                __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+                vmin = _mm256_min_epi32(vmin, v);
+                vmax = _mm256_max_epi32(vmax, v);
+            }
+            alignas(32) int lo[8], hi[8];
+            _mm256_store_si256(reinterpret_cast<__m256i*>(lo), vmin);
+            _mm256_store_si256(reinterpret_cast<__m256i*>(hi), vmax);
+            for (int j = 0; j < 8; ++j) {
+                mn = min(mn, lo[j]);
+                mx = max(mx, hi[j]);
+            }
+        }
+#elif defined(OOP2_SOA_SSE41)
+        if (n >= 4) {
+            __m128i vmin = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a));
+            __m128i vmax = vmin;
+            for (i = 4; i + 4 <= n; i += 4) {
+                __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+                vmin = _mm_min_epi32(vmin, v);
+                vmax = _mm_max_epi32(vmax, v);
+            }
+            alignas(16) int lo[4], hi[4];
+            _mm_store_si128(reinterpret_cast<__m128i*>(lo), vmin);
+            _mm_store_si128(reinterpret_cast<__m128i*>(hi), vmax);
+            for (int j = 0; j < 4; ++j) {
+                mn = min(mn, lo[j]);
+                mx = max(mx, hi[j]);
+            }
+        }
+#endif
+
+        for (; i < n; ++i) {
+            mn = min(mn, a[i]);
+            mx = max(mx, a[i]);
+        }
+
+    }
+
+    // Границы кругов по одной оси: минимум (c - r) и максимум (c + r), n > 0
+    inline void extents(const int* c, const double* r, size_t n, double& lo, double& hi) {
+
+        size_t i = 0;
+        lo = c[0] - r[0];
+        hi = c[0] + r[0];
+
+#if defined(OOP2_SOA_AVX2)
+        __m256d vlo = _mm256_set1_pd(lo), vhi = _mm256_set1_pd(hi);
+        for (; i + 4 <= n; i += 4) {
+            __m256d vc = _mm256_cvtepi32_pd(_mm_loadu_si128(reinterpret_cast<const __m128i*>(c + i)));
+            __m256d vr = _mm256_loadu_pd(r + i);
+            vlo = _mm256_min_pd(vlo, _mm256_sub_pd(vc, vr));
+            vhi = _mm256_max_pd(vhi, _mm256_add_pd(vc, vr));
+        }
+        alignas(32) double l[4], h[4];
+        _mm256_store_pd(l, vlo);
+        _mm256_store_pd(h, vhi);
+        for (int j = 0; j < 4; ++j) {
+            lo = min(lo, l[j]);
+            hi = max(hi, h[j]);
+        }
+#elif defined(OOP2_SOA_SSE2)
+        __m128d vlo = _mm_set1_pd(lo), vhi = _mm_set1_pd(hi);
+        for (; i + 2 <= n; i += 2) {
+            __m128d vc = _mm_cvtepi32_pd(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(c + i)));
+            __m128d vr = _mm_loadu_pd(r + i);
+            vlo = _mm_min_pd(vlo, _mm_sub_pd(vc, vr));
+            vhi = _mm_max_pd(vhi, _mm_add_pd(vc, vr));
+        }
+        alignas(16) double l[2], h[2];
+        _mm_store_pd(l, vlo);
+        _mm_store_pd(h, vhi);
+        for (int j = 0; j < 2; ++j) {
+            lo = min(lo, l[j]);
+            hi = max(hi, h[j]);
+        }
+#endif
+
+        for (; i < n; ++i) {
+            lo = min(lo, c[i] - r[i]);
+            hi = max(hi, c[i] + r[i]);
+        }
+
+    }
+
+    // Количество пар (xs[i], ys[i]), для которых (x - cx)^2 + (y - cy)^2 <= rs[i]^2.
+    // Если rs == nullptr, для всех элементов используется радиус r.
+    inline size_t countWithin(const int* xs, const int* ys, const double* rs, size_t n, int cx, int cy, double r) {
+
+        size_t i = 0;
+        size_t count = 0;
+
+#if defined(OOP2_SOA_AVX2)
+        __m256d vcx = _mm256_set1_pd(cx), vcy = _mm256_set1_pd(cy), vr = _mm256_set1_pd(r);
+        for (; i + 4 <= n; i += 4) {
+            __m256d dx = _mm256_sub_pd(_mm256_cvtepi32_pd(_mm_loadu_si128(reinterpret_cast<const __m128i*>(xs + i))), vcx);
+            __m256d dy = _mm256_sub_pd(_mm256_cvtepi32_pd(_mm_loadu_si128(reinterpret_cast<const __m128i*>(ys + i))), vcy);
+            __m256d d2 = _mm256_add_pd(_mm256_mul_pd(dx, dx), _mm256_mul_pd(dy, dy));
+            __m256d rr = rs ? _mm256_loadu_pd(rs + i) : vr;
+            int mask = _mm256_movemask_pd(_mm256_cmp_pd(d2, _mm256_mul_pd(rr, rr), _CMP_LE_OQ));
+            count += static_cast<size_t>(((mask >> 0) & 1) + ((mask >> 1) & 1) + ((mask >> 2) & 1) + ((mask >> 3) & 1));
+        }
+#elif defined(OOP2_SOA_SSE2)
+        __m128d vcx = _mm_set1_pd(cx), vcy = _mm_set1_pd(cy), vr = _mm_set1_pd(r);
+        for (; i + 2 <= n; i += 2) {
+            __m128d dx = _mm_sub_pd(_mm_cvtepi32_pd(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(xs + i))), vcx);
+            __m128d dy = _mm_sub_pd(_mm_cvtepi32_pd(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(ys + i))), vcy);
+            __m128d d2 = _mm_add_pd(_mm_mul_pd(dx, dx), _mm_mul_pd(dy, dy));
+            __m128d rr = rs ? _mm_loadu_pd(rs + i) : vr;
+            int mask = _mm_movemask_pd(_mm_cmple_pd(d2, _mm_mul_pd(rr, rr)));
+            count += static_cast<size_t>((mask & 1) + ((mask >> 1) & 1));
+        }
+#endif
+
+        for (; i < n; ++i) {
+            double dx = static_cast<double>(xs[i]) - cx;
+            double dy = static_cast<double>(ys[i]) - cy;
+            double rr = rs ? rs[i] : r;
+            if (dx * dx + dy * dy <= rr * rr) {
+                ++count;
+            }
+        }
+
+        return count;
+
+    }
+}
+
+// Прямоугольник, ограничивающий набор фигур
+struct BoundingBox {
+
+    double minX = 0, minY = 0, maxX = 0, maxY = 0;
+    bool empty = true;
+
+    bool operator==(const BoundingBox& other) const {
+
+        return empty == other.empty && minX == other.minX && minY == other.minY && maxX == other.maxX && maxY == other.maxY;
+
+    }
+};
+
+// Набор точек в виде структуры массивов: x и y лежат в отдельных непрерывных массивах,
+// поэтому пакетные операции идут без виртуальных вызовов и векторизуются
+class PointSoA {
+
+private:
+
+    vector<int> xs; // Координаты x
+    vector<int> ys; // Координаты y
+
+public:
+
+    size_t size() const { return xs.size(); }
+
+    void reserve(size_t n) {
+
+        xs.reserve(n);
+        ys.reserve(n);
+
+    }
+
+    void clear() {
+
+        xs.clear();
+        ys.clear();
+
+    }
+
+    void push_back(int x, int y) {
+
+        xs.push_back(x);
+        ys.push_back(y);
+
+    }
+
+    void push_back(const Point& p) {
+
+        push_back(p.getX(), p.getY());
+
+    }
+
+    int x(size_t i) const { return xs[i]; }
+    int y(size_t i) const { return ys[i]; }
+
+    const int* xData() const { return xs.data(); }
+    const int* yData() const { return ys.data(); }
+
+    // Сдвиг всех точек на (dx, dy)
+    void translate(int dx, int dy) {
+
+        soa_kernels::translate(xs.data(), xs.size(), dx);
+        soa_kernels::translate(ys.data(), ys.size(), dy);
+
+    }
+
+    // Масштабирование всех точек, результат совпадает с Point::scale
+    void scale(double factor) {
+
+        soa_kernels::scale(xs.data(), xs.size(), factor);
+        soa_kernels::scale(ys.data(), ys.size(), factor);
+
+    }
+
+    BoundingBox boundingBox() const {
+
+        BoundingBox box;
+        if (xs.empty()) {
+            return box;
+        }
+
+        int minX, maxX, minY, maxY;
+        soa_kernels::minMax(xs.data(), xs.size(), minX, maxX);
+        soa_kernels::minMax(ys.data(), ys.size(), minY, maxY);
+
+        box.minX = minX;
+        box.maxX = maxX;
+        box.minY = minY;
+        box.maxY = maxY;
+        box.empty = false;
+
+        return box;
+
+    }
+
+    // Количество точек внутри круга (cx, cy, r), граница включается
+    size_t countInCircle(int cx, int cy, double r) const {
+
+        return soa_kernels::countWithin(xs.data(), ys.data(), nullptr, xs.size(), cx, cy, r);
+
+    }
+
+    // Преобразование из существующих объектов и обратно
+
+    static PointSoA fromPoints(const vector<Point*>& points) {
+
+        PointSoA soa;
+        soa.reserve(points.size());
+        for (const Point* p : points) {
+            soa.push_back(*p);
+        }
+
+        return soa;
+
+    }
+
+    Point toPoint(size_t i) const {
+
+        return Point(xs[i], ys[i]);
+
+    }
+
+    vector<Point*> toPoints() const {
+
+        vector<Point*> points;
+        points.reserve(size());
+        for (size_t i = 0; i < size(); ++i) {
+            points.push_back(new Point(xs[i], ys[i])); // Владение передается вызывающему коду
+        }
+
+        return points;
+
+    }
+};
+
+// Набор кругов: центры хранятся как PointSoA, радиусы - отдельным массивом
+class CircleSoA {
+
+private:
+
+    PointSoA centers; // Центры кругов
+    vector<double> radii; // Радиусы кругов
+
+public:
+
+    size_t size() const { return radii.size(); }
+
+    void reserve(size_t n) {
+
+        centers.reserve(n);
+        radii.reserve(n);
+
+    }
+
+    void push_back(int x, int y, double r) {
+
+        centers.push_back(x, y);
+        radii.push_back(r);
+
+    }
+
+    void push_back(const Circle& c) {
+
+        push_back(c.getX(), c.getY(), c.getRadius());
+
+    }
+
+    int x(size_t i) const { return centers.x(i); }
+    int y(size_t i) const { return centers.y(i); }
+    double radius(size_t i) const { return radii[i]; }
+
+    void translate(int dx, int dy) {
+
+        centers.translate(dx, dy);
+
+    }
+
+    // Масштабирование центров и радиусов, результат совпадает с Circle::scale
+    void scale(double factor) {
+
+        centers.scale(factor);
+        soa_kernels::scale(radii.data(), radii.size(), factor);
+
+    }
+
+    // Прямоугольник, охватывающий все круги целиком
+    BoundingBox boundingBox() const {
+
+        BoundingBox box;
+        if (radii.empty()) {
+            return box;
+        }
+
+        soa_kernels::extents(centers.xData(), radii.data(), size(), box.minX, box.maxX);
+        soa_kernels::extents(centers.yData(), radii.data(), size(), box.minY, box.maxY);
+        box.empty = false;
+
+        return box;
+
+    }
+
+    // Количество кругов, содержащих точку (px, py)
+    size_t countContaining(int px, int py) const {
+
+        return soa_kernels::countWithin(centers.xData(), centers.yData(), radii.data(), size(), px, py, 0.0);
+
+    }
+
+    static CircleSoA fromCircles(const vector<Circle*>& circles) {
+
+        CircleSoA soa;
+        soa.reserve(circles.size());
+        for (const Circle* c : circles) {
+            soa.push_back(*c);
+        }
+
+        return soa;
+
+    }
+
+    Circle toCircle(size_t i) const {
+
+        return Circle(x(i), y(i), radii[i]);
+
+    }
+
+    vector<Circle*> toCircles() const {
+
+        vector<Circle*> circles;
+        circles.reserve(size());
+        for (size_t i = 0; i < size(); ++i) {
+            circles.push_back(new Circle(x(i), y(i), radii[i])); // Владение передается вызывающему коду
+        }
+
+        return circles;
+
+    }
+};
+
+// Замер: пакетные операции над vector<Point*> (виртуальный вызов на элемент) против PointSoA/CircleSoA
+void benchmarkSoA(size_t n) {
+
+    vector<Point*> points;
+    vector<Circle*> circles;
+    points.reserve(n);
+    circles.reserve(n);
+
+    optional<bench::MuteStream> mute;
+    mute.emplace(cout); // Конструкторы и деструкторы печатают сообщения, на замер они не нужны
+
+    for (size_t i = 0; i < n; ++i) {
+        int x = static_cast<int>((i * 7919) % 20001) - 10000;
+        int y = static_cast<int>((i * 104729) % 20001) - 10000;
+        points.push_back(new Point(x, y));
+        circles.push_back(new Circle(x, y, 1.0 + static_cast<double>(i % 97)));
+    }
+
+    PointSoA pointSoa = PointSoA::fromPoints(points);
+    CircleSoA circleSoa = CircleSoA::fromCircles(circles);
+    Circle* probe = new Circle(0, 0, 1000.0); // Круг для проверки попадания точек
+
+    // 1. Базовый вариант: объект за объектом через виртуальные методы
+    bench::Stopwatch timer;
+
+    for (Point* p : points) {
+        p->translate(3, -2);
+        p->scale(0.5);
+    }
+    for (Circle* c : circles) {
+        c->translate(3, -2);
+        c->scale(0.5);
+    }
+    uint64_t objTransformNs = timer.elapsedNs();
+
+    timer.restart();
+    BoundingBox objPointBox, objCircleBox;
+    for (const Point* p : points) {
+        double x = p->getX(), y = p->getY();
+        objPointBox.minX = objPointBox.empty ? x : min(objPointBox.minX, x);
+        objPointBox.maxX = objPointBox.empty ? x : max(objPointBox.maxX, x);
+        objPointBox.minY = objPointBox.empty ? y : min(objPointBox.minY, y);
+        objPointBox.maxY = objPointBox.empty ? y : max(objPointBox.maxY, y);
+        objPointBox.empty = false;
+    }
+    for (const Circle* c : circles) {
+        double x = c->getX(), y = c->getY(), r = c->getRadius();
+        objCircleBox.minX = objCircleBox.empty ? x - r : min(objCircleBox.minX, x - r);
+        objCircleBox.maxX = objCircleBox.empty ? x + r : max(objCircleBox.maxX, x + r);
+        objCircleBox.minY = objCircleBox.empty ? y - r : min(objCircleBox.minY, y - r);
+        objCircleBox.maxY = objCircleBox.empty ? y + r : max(objCircleBox.maxY, y + r);
+        objCircleBox.empty = false;
+    }
+    uint64_t objBoxNs = timer.elapsedNs();
+
+    timer.restart();
+    size_t objInside = 0, objContaining = 0;
+    for (const Point* p : points) {
+        objInside += probe->contains(p->getX(), p->getY()) ? 1 : 0;
+    }
+    for (const Circle* c : circles) {
+        objContaining += c->contains(0, 0) ? 1 : 0;
+    }
+    uint64_t objHitNs = timer.elapsedNs();
+
+    // 2. Структура массивов
+    timer.restart();
+    pointSoa.translate(3, -2);
+    pointSoa.scale(0.5);
+    circleSoa.translate(3, -2);
+    circleSoa.scale(0.5);
+    uint64_t soaTransformNs = timer.elapsedNs();
+
+    timer.restart();
+    BoundingBox soaPointBox = pointSoa.boundingBox();
+    BoundingBox soaCircleBox = circleSoa.boundingBox();
+    uint64_t soaBoxNs = timer.elapsedNs();
+
+    timer.restart();
+    size_t soaInside = pointSoa.countInCircle(probe->getX(), probe->getY(), probe->getRadius());
+    size_t soaContaining = circleSoa.countContaining(0, 0);
+    uint64_t soaHitNs = timer.elapsedNs();
+
+    // Результаты обоих вариантов обязаны совпадать
+    bool same = objPointBox == soaPointBox && objCircleBox == soaCircleBox
+        && objInside == soaInside && objContaining == soaContaining;
+    for (size_t i = 0; same && i < n; ++i) {
+        same = points[i]->getX() == pointSoa.x(i) && points[i]->getY() == pointSoa.y(i)
+            && circles[i]->getRadius() == circleSoa.radius(i);
+    }
+
+    for (size_t i = 0; i < n; ++i) {
+        delete points[i];
+        delete circles[i];
+    }
+    delete probe;
+
+    const char* simd =
+#if defined(OOP2_SOA_AVX2)
+        "AVX2";
+#elif defined(OOP2_SOA_SSE2)
+        "SSE2";
+#else
+        "скаляр";
+#endif
+
+    mute.reset();
+
+    auto row = [n](const char* name, uint64_t objNs, uint64_t soaNs) {
+        cout << "  " << name << ": объекты " << static_cast<double>(objNs) / n << " нс/элем, SoA "
+            << static_cast<double>(soaNs) / n << " нс/элем, ускорение x"
+            << static_cast<double>(objNs) / static_cast<double>(max<uint64_t>(soaNs, 1)) << endl;
+    };
+
+    cout << "PointSoA/CircleSoA против vector<Point*>, элементов: " << n << ", набор команд: " << simd << endl;
+    row("сдвиг + масштаб", objTransformNs, soaTransformNs);
+    row("ограничивающий прямоугольник", objBoxNs, soaBoxNs);
+    row("попадание в круг", objHitNs, soaHitNs);
+    cout << "  точек в круге: " << soaInside << ", кругов с точкой (0, 0): " << soaContaining << endl;
+    cout << "  результаты " << (same ? "совпадают" : "НЕ СОВПАДАЮТ") << endl;
+
+}
+
+// Нагрузка для сравнения распределителей: rounds раз создаем n прямоугольников,
+// копируем половину, присваиваем друг другу и разрушаем все
+template <class PointAllocator, class Reset>
+void churnRectangles(const char* title, size_t n, int rounds, PointAllocator alloc, Reset reset) {
+
+    lifecycle::ScopedMute mute;
+    size_t rssBefore = bench::currentRssKb();
+    size_t rssPeak = rssBefore;
+    alloc_hooks::AllocScope allocs;
+    bench::Stopwatch timer;
+
+    for (int r = 0; r < rounds; ++r) {
+        vector<BasicRectanglePtr<PointAllocator>> rects;
+        rects.reserve(n + n / 2);
+        for (size_t i = 0; i < n; ++i) {
+            int v = static_cast<int>(i);
+            rects.emplace_back(v, v, v + 1, v + 1, alloc);
+        }
+        for (size_t i = 0; i < n / 2; ++i) {
+            rects.emplace_back(rects[i]); // Копирование: новые точки
+        }
+        for (size_t i = 0; i < n; ++i) {
+            rects[i] = rects[n - 1 - i]; // Присваивание: точки переиспользуются
+        }
+        rssPeak = max(rssPeak, bench::currentRssKb());
+        rects.clear();
+        reset();
+    }
+
+    uint64_t ns = timer.elapsedNs();
+    alloc_hooks::AllocStats stats = allocs.delta();
+    double nodes = static_cast<double>(n + n / 2) * 2 * rounds; // Созданных объектов Point
+
+    cout << "  " << title << ": " << nodes / (static_cast<double>(ns) / 1e9) / 1e6 << " млн точек/с, "
+        << "вызовов operator new: " << stats.allocations << ", пик RSS +" << (rssPeak - rssBefore) << " КБ" << endl;
+
+}
+
+// Замер: распределение точек RectanglePtr в куче, пуле и арене
+void benchmarkPointPool(size_t n) {
+
+    const int rounds = 10;
+
+    cout << "Распределители точек RectanglePtr, прямоугольников: " << n << ", проходов: " << rounds << endl;
+
+    bench::runIsolated([&] {
+        churnRectangles("new/delete", n, rounds, HeapPointAllocator(), [] {});
+    });
+
+    bench::runIsolated([&] {
+        PointPool pool;
+        churnRectangles("пул", n, rounds, PoolPointAllocator(pool), [] {});
+    });
+
+    bench::runIsolated([&] {
+        PointArena arena;
+        churnRectangles("арена", n, rounds, ArenaPointAllocator(arena), [&arena] { arena.reset(); });
+    });
+
+}
+
+// RectanglePtr без операций перемещения: так вектор растет, если перемещение не объявлено
+struct CopyOnlyRectanglePtr : RectanglePtr {
+
+    using RectanglePtr::RectanglePtr;
+
+    CopyOnlyRectanglePtr(const CopyOnlyRectanglePtr& other) = default;
+    CopyOnlyRectanglePtr& operator=(const CopyOnlyRectanglePtr& other) = default;
+};
+
+// Заполняет вектор через emplace_back без reserve и считает, что происходило при перевыделениях
+template <class Shape>
+void measureGrowth(const char* title, size_t n) {
+
+    lifecycle::ScopedMute mute;
+    vector<Shape> shapes;
+    size_t reallocations = 0;
+
+    CopyMoveStats before = copyMoveStats;
+    alloc_hooks::AllocScope allocs;
+    bench::Stopwatch timer;
+
+    for (size_t i = 0; i < n; ++i) {
+        size_t capacity = shapes.capacity();
+        int v = static_cast<int>(i);
+        shapes.emplace_back(v, v, v + 1, v + 1);
+        if (shapes.capacity() != capacity) {
+            ++reallocations;
+        }
+    }
+
+    uint64_t ns = timer.elapsedNs();
+    uint64_t allocations = allocs.delta().allocations;
+    uint64_t created = n * (is_same<Shape, Rectangle>::value ? 0 : 2); // Точки самих новых элементов
+
+    cout << "  " << title << ": " << static_cast<double>(ns) / n << " нс/элемент, перевыделений: " << reallocations
+        << ", копирований: " << copyMoveStats.copies - before.copies
+        << ", перемещений: " << copyMoveStats.moves - before.moves
+        << ", выделений Point при росте: " << allocations - reallocations - created << endl;
+
+}
+
+// Замер: рост vector<Rectangle> и vector<RectanglePtr> с перемещением против копирования
+void benchmarkGrowth(size_t n) {
+
+    cout << "Рост вектора без reserve, элементов: " << n << endl;
+
+    measureGrowth<Rectangle>("vector<Rectangle>", n);
+    measureGrowth<RectanglePtr>("vector<RectanglePtr>", n);
+    measureGrowth<CopyOnlyRectanglePtr>("vector<RectanglePtr> без перемещения", n);
+
+}
+
+// Замкнутый набор фигур без виртуальной диспетчеризации.
+// Когда все типы известны при компиляции, фигуры хранятся по значению в std::variant,
+// std::visit выбирает обработчик по индексу альтернативы, а обработчики вызывают методы
+// с явной квалификацией (Circle::area), поэтому компилятор может их встроить
+using ShapeValue = variant<Point, Circle>;
+
+// Посетитель: площадь фигуры
+struct AreaVisitor {
+
+    double operator()(const Point& p) const { return p.Point::area(); }
+    double operator()(const Circle& c) const { return c.Circle::area(); }
+};
+
+// Посетитель: вывод фигуры
+struct PrintVisitor {
+
+    void operator()(const Point& p) const { p.Point::print(); }
+    void operator()(const Circle& c) const { c.Circle::print(); }
+};
+
+// Посетитель: запись фигуры в двоичный буфер
+struct SerializeVisitor {
+
+    string& out;
+
+    void operator()(const Point& p) const { p.Point::serialize(out); }
+    void operator()(const Circle& c) const { c.Circle::serialize(out); }
+};
+
+// Пакет фигур-значений с пакетными операциями; живет рядом с виртуальной иерархией
+class ShapeBatch {
+
+private:
+
+    vector<ShapeValue> shapes;
+
+public:
+
+    size_t size() const { return shapes.size(); }
+
+    void reserve(size_t n) { shapes.reserve(n); }
+
+    void addPoint(int x, int y) { shapes.emplace_back(in_place_type<Point>, x, y); }
+
+    void addCircle(int x, int y, double r) { shapes.emplace_back(in_place_type<Circle>, x, y, r); }
+
+    const ShapeValue& operator[](size_t i) const { return shapes[i]; }
+
+    // Применяет посетителя к каждой фигуре
+    template <class Visitor>
+    void forEach(Visitor&& visitor) const {
+
+        for (const ShapeValue& shape : shapes) {
+            visit(visitor, shape);
+        }
+
+    }
+
+    void print() const { forEach(PrintVisitor{}); }
+
+    double totalArea() const {
+
+        double sum = 0;
+        for (const ShapeValue& shape : shapes) {
+            sum += visit(AreaVisitor{}, shape);
+        }
+
+        return sum;
+
+    }
+
+    void serialize(string& out) const { forEach(SerializeVisitor{ out }); }
+
+    // Перенос из виртуальной иерархии (точный тип определяется через dynamic_cast)
+    static ShapeBatch fromPointers(const vector<Point*>& pointers) {
+
+        ShapeBatch batch;
+        batch.reserve(pointers.size());
+        for (const Point* p : pointers) {
+            if (const Circle* c = dynamic_cast<const Circle*>(p)) {
+                batch.addCircle(c->getX(), c->getY(), c->getRadius());
+            }
+            else {
+                batch.addPoint(p->getX(), p->getY());
+            }
+        }
+
+        return batch;
+
+    }
+};
+
+// Замер: площадь и сериализация смешанного набора через виртуальные вызовы и через std::variant
+void benchmarkVariant(size_t n) {
+
+    lifecycle::ScopedMute mute;
+
+    vector<Point*> pointers;
+    pointers.reserve(n);
+    for (size_t i = 0; i < n; ++i) {
+        int v = static_cast<int>(i % 1000);
+        if ((i * 2654435761u) & 1) {
+            pointers.push_back(new Circle(v, -v, 1.0 + (i % 10)));
+        }
+        else {
+            pointers.push_back(new Point(v, -v));
+        }
+    }
+    ShapeBatch batch = ShapeBatch::fromPointers(pointers);
+
+    bench::Stopwatch timer;
+    double virtualArea = 0;
+    for (const Point* p : pointers) {
+        virtualArea += p->area();
+    }
+    uint64_t virtualAreaNs = timer.elapsedNs();
+
+    timer.restart();
+    double variantArea = batch.totalArea();
+    uint64_t variantAreaNs = timer.elapsedNs();
+
+    string virtualBytes, variantBytes;
+    virtualBytes.reserve(n * 17);
+    variantBytes.reserve(n * 17);
+
+    timer.restart();
+    for (const Point* p : pointers) {
+        p->serialize(virtualBytes);
+    }
+    uint64_t virtualSerializeNs = timer.elapsedNs();
+
+    timer.restart();
+    batch.serialize(variantBytes);
+    uint64_t variantSerializeNs = timer.elapsedNs();
+
+    for (Point* p : pointers) {
+        delete p;
+    }
+
+    cout << "Смешанный набор Point/Circle, фигур: " << n << endl;
+    cout << "  площадь: виртуальные вызовы " << static_cast<double>(virtualAreaNs) / n << " нс/фигуру, variant "
+        << static_cast<double>(variantAreaNs) / n << " нс/фигуру" << endl;
+    cout << "  сериализация: виртуальные вызовы " << static_cast<double>(virtualSerializeNs) / n << " нс/фигуру, variant "
+        << static_cast<double>(variantSerializeNs) / n << " нс/фигуру" << endl;
+    cout << "  результаты " << (virtualArea == variantArea && virtualBytes == variantBytes ? "совпадают" : "НЕ СОВПАДАЮТ") << endl;
+
+}
+
+// Фигура в пространственном индексе: ограничивающий прямоугольник и точная геометрия
+struct IndexedShape {
+
+    BoundingBox box; // Ограничивающий прямоугольник
+    bool circle = false; // Круг (иначе прямоугольник, совпадающий с box)
+    double cx = 0, cy = 0, r = 0; // Центр и радиус круга
+
+    static IndexedShape of(const Rectangle& rect) {
+
+        IndexedShape shape;
+        const Point& a = rect.getTopLeft();
+        const Point& b = rect.getBottomRight();
+        shape.box.minX = min(a.getX(), b.getX());
+        shape.box.maxX = max(a.getX(), b.getX());
+        shape.box.minY = min(a.getY(), b.getY());
+        shape.box.maxY = max(a.getY(), b.getY());
+        shape.box.empty = false;
+
+        return shape;
+
+    }
+
+    static IndexedShape of(const Circle& c) {
+
+        IndexedShape shape;
+        shape.circle = true;
+        shape.cx = c.getX();
+        shape.cy = c.getY();
+        shape.r = c.getRadius();
+        shape.box.minX = shape.cx - shape.r;
+        shape.box.maxX = shape.cx + shape.r;
+        shape.box.minY = shape.cy - shape.r;
+        shape.box.maxY = shape.cy + shape.r;
+        shape.box.empty = false;
+
+        return shape;
+
+    }
+
+    // Квадрат расстояния от точки до прямоугольника (0, если точка внутри)
+    static double distance2(const BoundingBox& b, double x, double y) {
+
+        double dx = x < b.minX ? b.minX - x : (x > b.maxX ? x - b.maxX : 0);
+        double dy = y < b.minY ? b.minY - y : (y > b.maxY ? y - b.maxY : 0);
+
+        return dx * dx + dy * dy;
+
+    }
+
+    static bool intersects(const BoundingBox& a, const BoundingBox& b) {
+
+        return a.minX <= b.maxX && b.minX <= a.maxX && a.minY <= b.maxY && b.minY <= a.maxY;
+
+    }
+
+    bool contains(double x, double y) const {
+
+        if (circle) {
+            return (x - cx) * (x - cx) + (y - cy) * (y - cy) <= r * r;
+        }
+
+        return distance2(box, x, y) == 0;
+
+    }
+
+    bool intersects(const BoundingBox& range) const {
+
+        if (circle) {
+            return distance2(range, cx, cy) <= r * r;
+        }
+
+        return intersects(box, range);
+
+    }
+
+    // Квадрат расстояния от точки до фигуры
+    double distance2(double x, double y) const {
+
+        if (circle) {
+            double d = sqrt((x - cx) * (x - cx) + (y - cy) * (y - cy)) - r;
+            return d > 0 ? d * d : 0;
+        }
+
+        return distance2(box, x, y);
+
+    }
+};
+
+// Пространственный индекс над Rectangle и Circle - R-дерево.
+// Пакетная загрузка упаковывает дерево методом STR (Sort-Tile-Recursive), вставка и удаление
+// работают по Гуттману с квадратичным разбиением узлов. Запросы спускаются только в узлы,
+// чьи прямоугольники пересекают область поиска, поэтому на разреженных данных время
+// запроса растет логарифмически, а не линейно
+class SpatialIndex {
+
+public:
+
+    using Id = size_t; // Номер фигуры: порядок добавления
+
+private:
+
+    struct Node {
+
+        bool leaf = true;
+        int parent = -1;
+        BoundingBox box;
+        vector<size_t> entries; // Номера фигур (в листе) или дочерних узлов
+
+    };
+
+    vector<IndexedShape> shapes; // Все когда-либо добавленные фигуры
+    vector<char> alive; // Фигура еще в индексе
+    vector<int> leafOf; // Лист, в котором лежит фигура
+    vector<Node> nodes;
+    vector<int> freeNodes; // Освобожденные узлы для повторного использования
+    int root = -1;
+    size_t maxEntries, minEntries;
+    size_t count = 0;
+
+    static BoundingBox unite(const BoundingBox& a, const BoundingBox& b) {
+
+        if (a.empty) {
+            return b;
+        }
+        if (b.empty) {
+            return a;
+        }
+
+        BoundingBox u;
+        u.minX = min(a.minX, b.minX);
+        u.minY = min(a.minY, b.minY);
+        u.maxX = max(a.maxX, b.maxX);
+        u.maxY = max(a.maxY, b.maxY);
+        u.empty = false;
+
+        return u;
+
+    }
+
+    static double area(const BoundingBox& b) {
+
+        return b.empty ? 0 : (b.maxX - b.minX) * (b.maxY - b.minY);
+
+    }
+
+    int newNode(bool leaf) {
+
+        int id;
+        if (!freeNodes.empty()) {
+            id = freeNodes.back();
+            freeNodes.pop_back();
+            nodes[id] = Node();
+        }
+        else {
+            id = static_cast<int>(nodes.size());
+            nodes.emplace_back();
+        }
+        nodes[id].leaf = leaf;
+
+        return id;
+
+    }
+
+    void freeNode(int id) {
+
+        nodes[id].entries.clear();
+        freeNodes.push_back(id);
+
+    }
+
+    const BoundingBox& entryBox(const Node& node, size_t entry) const {
+
+        return node.leaf ? shapes[entry].box : nodes[entry].box;
+
+    }
+
+    void attach(int node, size_t entry) {
+
+        if (nodes[node].leaf) {
+            leafOf[entry] = node;
+        }
+        else {
+            nodes[entry].parent = node;
+        }
+
+    }
+
+    void recomputeBox(int id) {
+
+        BoundingBox box;
+        for (size_t entry : nodes[id].entries) {
+            box = unite(box, entryBox(nodes[id], entry));
+        }
+        nodes[id].box = box;
+
+    }
+
+    int chooseLeaf(const BoundingBox& box) const {
+
+        int id = root;
+        while (!nodes[id].leaf) {
+            const Node& node = nodes[id];
+            int best = -1;
+            double bestGrowth = 0, bestArea = 0;
+            for (size_t child : node.entries) {
+                double childArea = area(nodes[child].box);
+                double growth = area(unite(nodes[child].box, box)) - childArea;
+                if (best < 0 || growth < bestGrowth || (growth == bestGrowth && childArea < bestArea)) {
+                    best = static_cast<int>(child);
+                    bestGrowth = growth;
+                    bestArea = childArea;
+                }
+            }
+            id = best;
+        }
+
+        return id;
+
+    }
+
+    // Квадратичное разбиение переполненного узла; возвращает новый узел-сосед
+    int split(int id) {
+
+        vector<size_t> all = move(nodes[id].entries);
+        int sibling = newNode(nodes[id].leaf);
+        const Node& node = nodes[id];
+
+        // Затравки: пара, которую хуже всего держать в одном узле
+        size_t s1 = 0, s2 = 1;
+        double worst = -1;
+        for (size_t i = 0; i < all.size(); ++i) {
+            for (size_t j = i + 1; j < all.size(); ++j) {
+                const BoundingBox& a = entryBox(node, all[i]);
+                const BoundingBox& b = entryBox(node, all[j]);
+                double waste = area(unite(a, b)) - area(a) - area(b);
+                if (waste > worst) {
+                    worst = waste;
+                    s1 = i;
+                    s2 = j;
+                }
+            }
+        }
+
+        vector<size_t> g1{ all[s1] }, g2{ all[s2] };
+        BoundingBox b1 = entryBox(node, all[s1]), b2 = entryBox(node, all[s2]);
+        vector<size_t> rest;
+        for (size_t i = 0; i < all.size(); ++i) {
+            if (i != s1 && i != s2) {
+                rest.push_back(all[i]);
+            }
+        }
+
+        while (!rest.empty()) {
+            // Минимальное заполнение: если группе не хватает ровно оставшихся, отдаем их ей
+            if (g1.size() + rest.size() == minEntries || g2.size() + rest.size() == minEntries) {
+                vector<size_t>& target = g1.size() + rest.size() == minEntries ? g1 : g2;
+                BoundingBox& targetBox = &target == &g1 ? b1 : b2;
+                for (size_t entry : rest) {
+                    target.push_back(entry);
+                    targetBox = unite(targetBox, entryBox(node, entry));
+                }
+                break;
+            }
+
+            // Следующей берем запись с самым сильным предпочтением одной из групп
+            size_t pick = 0;
+            double bestDiff = -1, grow1 = 0, grow2 = 0;
+            for (size_t i = 0; i < rest.size(); ++i) {
+                const BoundingBox& b = entryBox(node, rest[i]);
+                double d1 = area(unite(b1, b)) - area(b1);
+                double d2 = area(unite(b2, b)) - area(b2);
+                if (fabs(d1 - d2) > bestDiff) {
+                    bestDiff = fabs(d1 - d2);
+                    pick = i;
+                    grow1 = d1;
+                    grow2 = d2;
+                }
+            }
+
+            size_t entry = rest[pick];
+            rest[pick] = rest.back();
+            rest.pop_back();
+
+            bool toFirst = grow1 < grow2 || (grow1 == grow2 && (area(b1) < area(b2) || (area(b1) == area(b2) && g1.size() <= g2.size())));
+            if (toFirst) {
+                g1.push_back(entry);
+                b1 = unite(b1, entryBox(node, entry));
+            }
+            else {
+                g2.push_back(entry);
+                b2 = unite(b2, entryBox(node, entry));
+            }
+        }
+
+        nodes[id].entries = move(g1);
+        nodes[id].box = b1;
+        nodes[sibling].entries = move(g2);
+        nodes[sibling].box = b2;
+        for (size_t entry : nodes[sibling].entries) {
+            attach(sibling, entry);
+        }
+
+        return sibling;
+
+    }
+
+    // Подъем от измененного узла к корню: разбиение переполненных узлов и пересчет рамок
+    void adjustUpwards(int id) {
+
+        while (id >= 0) {
+            int parent = nodes[id].parent;
+            if (nodes[id].entries.size() > maxEntries) {
+                int sibling = split(id);
+                if (parent < 0) {
+                    int newRoot = newNode(false);
+                    nodes[newRoot].entries = { static_cast<size_t>(id), static_cast<size_t>(sibling) };
+                    nodes[id].parent = newRoot;
+                    nodes[sibling].parent = newRoot;
+                    recomputeBox(newRoot);
+                    root = newRoot;
+                    return;
+                }
+                nodes[parent].entries.push_back(static_cast<size_t>(sibling));
+                nodes[sibling].parent = parent;
+            }
+            else {
+                recomputeBox(id);
+            }
+            id = parent;
+        }
+
+    }
+
+    void insertExisting(Id id) {
+
+        if (root < 0) {
+            root = newNode(true);
+        }
+
+        int leaf = chooseLeaf(shapes[id].box);
+        nodes[leaf].entries.push_back(id);
+        leafOf[id] = leaf;
+        adjustUpwards(leaf);
+
+    }
+
+    // Собирает фигуры поддерева и освобождает его узлы
+    void collectShapes(int id, vector<Id>& out) {
+
+        if (nodes[id].leaf) {
+            out.insert(out.end(), nodes[id].entries.begin(), nodes[id].entries.end());
+        }
+        else {
+            for (size_t child : nodes[id].entries) {
+                collectShapes(static_cast<int>(child), out);
+            }
+        }
+        freeNode(id);
+
+    }
+
+    // Упаковка одного уровня методом STR; возвращает созданные узлы
+    vector<size_t> packLevel(vector<size_t> entries, bool leaf) {
+
+        vector<size_t> packed;
+        if (entries.empty()) {
+            return packed;
+        }
+
+        auto box = [&](size_t entry) -> const BoundingBox& { return leaf ? shapes[entry].box : nodes[entry].box; };
+        auto centerX = [&](size_t entry) { return box(entry).minX + box(entry).maxX; };
+        auto centerY = [&](size_t entry) { return box(entry).minY + box(entry).maxY; };
+
+        size_t leaves = (entries.size() + maxEntries - 1) / maxEntries;
+        size_t slices = static_cast<size_t>(ceil(sqrt(static_cast<double>(leaves))));
+        size_t sliceSize = slices * maxEntries;
+
+        sort(entries.begin(), entries.end(), [&](size_t a, size_t b) { return centerX(a) < centerX(b); });
+
+        for (size_t start = 0; start < entries.size(); start += sliceSize) {
+            size_t end = min(entries.size(), start + sliceSize);
+            sort(entries.begin() + start, entries.begin() + end, [&](size_t a, size_t b) { return centerY(a) < centerY(b); });
+            for (size_t i = start; i < end; i += maxEntries) {
+                int id = newNode(leaf);
+                nodes[id].entries.assign(entries.begin() + i, entries.begin() + min(end, i + maxEntries));
+                for (size_t entry : nodes[id].entries) {
+                    attach(id, entry);
+                }
+                recomputeBox(id);
+                packed.push_back(static_cast<size_t>(id));
+            }
+        }
+
+        return packed;
+
+    }
+
+    Id addShape(const IndexedShape& shape) {
+
+        shapes.push_back(shape);
+        alive.push_back(1);
+        leafOf.push_back(-1);
+        ++count;
+
+        return shapes.size() - 1;
+
+    }
+
+public:
+
+    explicit SpatialIndex(size_t maxEntries = 16) : maxEntries(max<size_t>(maxEntries, 4)), minEntries(max<size_t>(maxEntries, 4) * 2 / 5) {}
+
+    size_t size() const { return count; }
+
+    const IndexedShape& shape(Id id) const { return shapes[id]; }
+
+    void clear() {
+
+        shapes.clear();
+        alive.clear();
+        leafOf.clear();
+        nodes.clear();
+        freeNodes.clear();
+        root = -1;
+        count = 0;
+
+    }
+
+    // Пакетная загрузка: прямоугольники получают номера 0..R-1, круги - R..R+C-1
+    void bulkLoad(const vector<Rectangle>& rects, const vector<Circle>& circles) {
+
+        clear();
+        shapes.reserve(rects.size() + circles.size());
+        for (const Rectangle& rect : rects) {
+            addShape(IndexedShape::of(rect));
+        }
+        for (const Circle& c : circles) {
+            addShape(IndexedShape::of(c));
+        }
+
+        vector<size_t> level(shapes.size());
+        for (size_t i = 0; i < level.size(); ++i) {
+            level[i] = i;
+        }
+
+        bool leaf = true;
+        do {
+            level = packLevel(move(level), leaf);
+            leaf = false;
+        } while (level.size() > 1);
+
+        root = level.empty() ? -1 : static_cast<int>(level[0]);
+
+    }
+
+    Id insert(const Rectangle& rect) {
+
+        Id id = addShape(IndexedShape::of(rect));
+        insertExisting(id);
+
+        return id;
+
+    }
+
+    Id insert(const Circle& c) {
+
+        Id id = addShape(IndexedShape::of(c));
+        insertExisting(id);
+
+        return id;
+
+    }
+
+    // Удаление фигуры; недозаполненные узлы распускаются, их фигуры вставляются заново
+    bool remove(Id id) {
+
+        if (id >= shapes.size() || !alive[id]) {
+            return false;
+        }
+
+        int leaf = leafOf[id];
+        vector<size_t>& entries = nodes[leaf].entries;
+        entries.erase(find(entries.begin(), entries.end(), id));
+        alive[id] = 0;
+        leafOf[id] = -1;
+        --count;
+
+        vector<Id> orphans;
+        int node = leaf;
+        while (node != root) {
+            int parent = nodes[node].parent;
+            if (nodes[node].entries.size() < minEntries) {
+                vector<size_t>& siblings = nodes[parent].entries;
+                siblings.erase(find(siblings.begin(), siblings.end(), static_cast<size_t>(node)));
+                collectShapes(node, orphans);
+            }
+            else {
+                recomputeBox(node);
+            }
+            node = parent;
+        }
+
+        // Корень с единственным потомком заменяется этим потомком
+        while (!nodes[root].leaf && nodes[root].entries.size() == 1) {
+            int child = static_cast<int>(nodes[root].entries[0]);
+            freeNode(root);
+            root = child;
+            nodes[root].parent = -1;
+        }
+        if (!nodes[root].leaf && nodes[root].entries.empty()) {
+            nodes[root].leaf = true;
+        }
+        recomputeBox(root);
+
+        for (Id orphan : orphans) {
+            insertExisting(orphan);
+        }
+
+        return true;
+
+    }
+
+    // Фигуры, содержащие точку (x, y)
+    vector<Id> queryPoint(double x, double y) const {
+
+        vector<Id> result;
+        if (root < 0) {
+            return result;
+        }
+
+        vector<int> stack{ root };
+        while (!stack.empty()) {
+            const Node& node = nodes[stack.back()];
+            stack.pop_back();
+            if (node.box.empty || IndexedShape::distance2(node.box, x, y) > 0) {
+                continue;
+            }
+            for (size_t entry : node.entries) {
+                if (node.leaf) {
+                    if (shapes[entry].contains(x, y)) {
+                        result.push_back(entry);
+                    }
+                }
+                else {
+                    stack.push_back(static_cast<int>(entry));
+                }
+            }
+        }
+
+        return result;
+
+    }
+
+    // Фигуры, пересекающие прямоугольную область
+    vector<Id> queryRange(const BoundingBox& range) const {
+
+        vector<Id> result;
+        if (root < 0 || range.empty) {
+            return result;
+        }
+
+        vector<int> stack{ root };
+        while (!stack.empty()) {
+            const Node& node = nodes[stack.back()];
+            stack.pop_back();
+            if (node.box.empty || !IndexedShape::intersects(node.box, range)) {
+                continue;
+            }
+            for (size_t entry : node.entries) {
+                if (node.leaf) {
+                    if (shapes[entry].intersects(range)) {
+                        result.push_back(entry);
+                    }
+                }
+                else {
+                    stack.push_back(static_cast<int>(entry));
+                }
+            }
+        }
+
+        return result;
+
+    }
+
+    // k ближайших к точке фигур в порядке возрастания расстояния (поиск "лучший-первым")
+    vector<Id> nearest(double x, double y, size_t k) const {
+
+        vector<Id> result;
+        if (root < 0 || k == 0) {
+            return result;
+        }
+
+        struct Candidate {
+            double distance2;
+            bool shape; // Фигура (иначе узел)
+            size_t index;
+            bool operator>(const Candidate& other) const { return distance2 > other.distance2; }
+        };
+
+        priority_queue<Candidate, vector<Candidate>, greater<Candidate>> queue;
+        queue.push({ 0, false, static_cast<size_t>(root) });
+
+        while (!queue.empty() && result.size() < k) {
+            Candidate top = queue.top();
+            queue.pop();
+            if (top.shape) {
+                result.push_back(top.index);
+                continue;
+            }
+            const Node& node = nodes[top.index];
+            for (size_t entry : node.entries) {
+                if (node.leaf) {
+                    queue.push({ shapes[entry].distance2(x, y), true, entry });
+                }
+                else if (!nodes[entry].box.empty) {
+                    queue.push({ IndexedShape::distance2(nodes[entry].box, x, y), false, entry });
+                }
+            }
+        }
+
+        return result;
+
+    }
+};
+
+// Замер: R-дерево против полного перебора на точечных, диапазонных и kNN-запросах
+void benchmarkSpatialIndex(size_t n) {
+
+    lifecycle::ScopedMute mute;
+
+    const int world = 100000; // Сторона квадрата, в котором лежат фигуры
+    vector<Rectangle> rects;
+    vector<Circle> circles;
+    rects.reserve(n / 2);
+    circles.reserve(n - n / 2);
+    uint64_t seed = 12345;
+    auto next = [&seed](int bound) {
+        seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+        return static_cast<int>((seed >> 33) % static_cast<uint64_t>(bound));
+    };
+    for (size_t i = 0; i < n / 2; ++i) {
+        int x = next(world), y = next(world);
+        rects.emplace_back(x, y, x + 1 + next(50), y + 1 + next(50));
+    }
+    for (size_t i = n / 2; i < n; ++i) {
+        circles.emplace_back(next(world), next(world), 1.0 + next(25));
+    }
+
+    vector<IndexedShape> all; // Для полного перебора
+    all.reserve(n);
+    for (const Rectangle& rect : rects) {
+        all.push_back(IndexedShape::of(rect));
+    }
+    for (const Circle& c : circles) {
+        all.push_back(IndexedShape::of(c));
+    }
+
+    bench::Stopwatch timer;
+    SpatialIndex index;
+    index.bulkLoad(rects, circles);
+    uint64_t buildNs = timer.elapsedNs();
+
+    const size_t queries = 200;
+    const size_t k = 10;
+    vector<pair<int, int>> probes;
+    for (size_t q = 0; q < queries; ++q) {
+        probes.emplace_back(next(world), next(world));
+    }
+
+    bool same = true;
+    uint64_t treeNs[3] = {}, bruteNs[3] = {};
+
+    for (const auto& probe : probes) {
+        double px = probe.first, py = probe.second;
+        BoundingBox range;
+        range.minX = px;
+        range.minY = py;
+        range.maxX = px + 500;
+        range.maxY = py + 500;
+        range.empty = false;
+
+        // Точка
+        timer.restart();
+        vector<SpatialIndex::Id> hits = index.queryPoint(px, py);
+        treeNs[0] += timer.elapsedNs();
+        timer.restart();
+        vector<SpatialIndex::Id> bruteHits;
+        for (size_t i = 0; i < all.size(); ++i) {
+            if (all[i].contains(px, py)) {
+                bruteHits.push_back(i);
+            }
+        }
+        bruteNs[0] += timer.elapsedNs();
+        sort(hits.begin(), hits.end());
+        same = same && hits == bruteHits;
+
+        // Диапазон
+        timer.restart();
+        hits = index.queryRange(range);
+        treeNs[1] += timer.elapsedNs();
+        timer.restart();
+        bruteHits.clear();
+        for (size_t i = 0; i < all.size(); ++i) {
+            if (all[i].intersects(range)) {
+                bruteHits.push_back(i);
+            }
+        }
+        bruteNs[1] += timer.elapsedNs();
+        sort(hits.begin(), hits.end());
+        same = same && hits == bruteHits;
+
+        // k ближайших: сравниваем расстояния, при равенстве номера могут отличаться
+        timer.restart();
+        hits = index.nearest(px, py, k);
+        treeNs[2] += timer.elapsedNs();
+        timer.restart();
+        vector<double> bruteDistances(all.size());
+        for (size_t i = 0; i < all.size(); ++i) {
+            bruteDistances[i] = all[i].distance2(px, py);
+        }
+        partial_sort(bruteDistances.begin(), bruteDistances.begin() + k, bruteDistances.end());
+        bruteNs[2] += timer.elapsedNs();
+        for (size_t i = 0; i < k && i < hits.size(); ++i) {
+            same = same && all[hits[i]].distance2(px, py) == bruteDistances[i];
+        }
+    }
+
+    // Инкрементальные изменения: удаляем и возвращаем часть фигур
+    timer.restart();
+    size_t changes = min<size_t>(n, 10000);
+    for (size_t i = 0; i < changes; ++i) {
+        index.remove(i);
+    }
+    for (size_t i = 0; i < changes && i < rects.size(); ++i) {
+        index.insert(rects[i]);
+    }
+    uint64_t updateNs = timer.elapsedNs();
+
+    const char* names[3] = { "точка", "диапазон 500x500", "10 ближайших" };
+    cout << "SpatialIndex, фигур: " << n << ", построение STR: " << buildNs / 1000000 << " мс" << endl;
+    for (int i = 0; i < 3; ++i) {
+        cout << "  " << names[i] << ": R-дерево " << static_cast<double>(treeNs[i]) / queries / 1000 << " мкс/запрос, перебор "
+            << static_cast<double>(bruteNs[i]) / queries / 1000 << " мкс/запрос" << endl;
+    }
+    cout << "  удаление + вставка: " << static_cast<double>(updateNs) / (2 * changes) / 1000 << " мкс/операция, фигур в индексе: " << index.size() << endl;
+    cout << "  результаты " << (same ? "совпадают" : "НЕ СОВПАДАЮТ") << " с полным перебором" << endl;
+
+}
+
+// Двоичный файл фигур: заголовок, таблица типов и по одной секции записей фиксированной ширины на тип.
+// Секции выровнены, поэтому файл, отображенный в память, читается прямо на месте - без разбора
+// и без создания объектов в куче. Числа записаны в порядке байт машины, создавшей файл.
+
+struct PointRecord {
+    int32_t x, y;
+};
+
+struct CircleRecord {
+    int32_t x, y;
+    double radius;
+};
+
+struct RectangleRecord {
+    int32_t x1, y1, x2, y2;
+};
+
+static_assert(sizeof(PointRecord) == 8 && sizeof(CircleRecord) == 16 && sizeof(RectangleRecord) == 16, "Записи без выравнивающих дыр");
+
+enum class ShapeType : uint32_t { Point = 'P', Circle = 'C', Rectangle = 'R' };
+
+template <class Record>
+struct ShapeRecordType;
+
+template <>
+struct ShapeRecordType<PointRecord> { static constexpr ShapeType value = ShapeType::Point; };
+
+template <>
+struct ShapeRecordType<CircleRecord> { static constexpr ShapeType value = ShapeType::Circle; };
+
+template <>
+struct ShapeRecordType<RectangleRecord> { static constexpr ShapeType value = ShapeType::Rectangle; };
+
+struct ShapeFileHeader {
+    char magic[8];      // "OOPSHAPE"
+    uint32_t version;
+    uint32_t typeCount; // Элементов в таблице типов; таблица идет сразу за заголовком
+    uint64_t fileSize;
+};
+
+// Элемент таблицы типов: где лежит секция и сколько в ней записей
+struct ShapeFileTypeEntry {
+    uint32_t type;       // ShapeType
+    uint32_t recordSize; // Байт на запись
+    uint64_t count;
+    uint64_t offset;     // Начало секции от начала файла
+};
+
+const char kShapeFileMagic[8] = { 'O', 'O', 'P', 'S', 'H', 'A', 'P', 'E' };
+const uint32_t kShapeFileVersion = 1;
+const uint32_t kShapeFileMaxTypes = 3;
+const uint64_t kShapeFileAlign = 64;
+
+// Потоковая запись: в памяти держится только буфер текущей секции.
+// Фигуры одного типа должны идти подряд (каждый тип - одна секция); заголовок дописывается в finish()
+class ShapeFileWriter {
+
+private:
+
+    FILE* file;
+    ShapeFileTypeEntry table[kShapeFileMaxTypes];
+    uint32_t typeCount = 0;
+    uint64_t position = 0;
+    vector<char> buffer;
+    bool failed = false;
+
+    void flushBuffer() {
+
+        if (!buffer.empty() && file && fwrite(buffer.data(), 1, buffer.size(), file) != buffer.size()) {
+            failed = true;
+        }
+        buffer.clear();
+
+    }
+
+    void padTo(uint64_t alignment) {
+
+        while (position % alignment != 0) {
+            buffer.push_back(0);
+            ++position;
+        }
+
+    }
+
+    template <class Record>
+    void append(const Record& record) {
+
+        uint32_t type = static_cast<uint32_t>(ShapeRecordType<Record>::value);
+        if (typeCount == 0 || table[typeCount - 1].type != type) {
+            for (uint32_t i = 0; i < typeCount; ++i) {
+                if (table[i].type == type) {
+                    failed = true; // Секция этого типа уже закрыта
+                    return;
+                }
+            }
+            padTo(kShapeFileAlign);
+            table[typeCount++] = { type, static_cast<uint32_t>(sizeof(Record)), 0, position };
+        }
+
+        const char* bytes = reinterpret_cast<const char*>(&record);
+        buffer.insert(buffer.end(), bytes, bytes + sizeof(Record));
+        position += sizeof(Record);
+        ++table[typeCount - 1].count;
+
+        if (buffer.size() >= (1u << 16)) {
+            flushBuffer();
+        }
+
+    }
+
+public:
+
+    explicit ShapeFileWriter(const string& path) : file(fopen(path.c_str(), "wb")) {
+
+        failed = file == nullptr;
+        position = sizeof(ShapeFileHeader) + sizeof(table); // Место под заголовок и таблицу
+        buffer.assign(position, 0);
+
+    }
+
+    ~ShapeFileWriter() {
+
+        finish();
+
+    }
+
+    ShapeFileWriter(const ShapeFileWriter&) = delete;
+    ShapeFileWriter& operator=(const ShapeFileWriter&) = delete;
+
+    void add(const PointRecord& record) { append(record); }
+    void add(const CircleRecord& record) { append(record); }
+    void add(const RectangleRecord& record) { append(record); }
+
+    void add(const Point& p) { append(PointRecord{ p.getX(), p.getY() }); }
+
+    void add(const Circle& c) { append(CircleRecord{ c.getX(), c.getY(), c.getRadius() }); }
+
+    void add(const Rectangle& r) {
+        append(RectangleRecord{ r.getTopLeft().getX(), r.getTopLeft().getY(), r.getBottomRight().getX(), r.getBottomRight().getY() });
+    }
+
+    // Дописывает заголовок и закрывает файл; false, если что-то не записалось или порядок секций нарушен
+    bool finish() {
+
+        if (!file) {
+            return !failed;
+        }
+
+        padTo(kShapeFileAlign);
+        flushBuffer();
+
+        ShapeFileHeader header;
+        memcpy(header.magic, kShapeFileMagic, sizeof(header.magic));
+        header.version = kShapeFileVersion;
+        header.typeCount = typeCount;
+        header.fileSize = position;
+
+        if (fseek(file, 0, SEEK_SET) != 0
+            || fwrite(&header, sizeof(header), 1, file) != 1
+            || fwrite(table, sizeof(table), 1, file) != 1) {
+            failed = true;
+        }
+        if (fclose(file) != 0) {
+            failed = true;
+        }
+        file = nullptr;
+
+        return !failed;
+
+    }
+};
+
+// Непрерывный диапазон записей внутри файла
+template <class Record>
+class RecordRange {
+
+private:
+
+    const Record* first = nullptr;
+    size_t count = 0;
+
+public:
+
+    RecordRange() = default;
+
+    RecordRange(const Record* first, size_t count) : first(first), count(count) {}
+
+    const Record* begin() const { return first; }
+
+    const Record* end() const { return first + count; }
+
+    size_t size() const { return count; }
+
+    bool empty() const { return count == 0; }
+
+    const Record& operator[](size_t i) const { return first[i]; }
+};
+
+// Только читающий вид файла фигур. Файл отображается в память (mmap); если это невозможно
+// или useMmap == false, он целиком читается в буфер. Записи не копируются и объекты не создаются
+class ShapeFileView {
+
+private:
+
+    const char* data = nullptr;
+    size_t length = 0;
+    bool mapped = false;
+    vector<char> contents; // Содержимое файла, если он не отображен в память
+    string errorText;
+
+    RecordRange<PointRecord> pointRange;
+    RecordRange<CircleRecord> circleRange;
+    RecordRange<RectangleRecord> rectangleRange;
+
+    bool fail(const string& message) {
+
+        errorText = message;
+        return false;
+
+    }
+
+    bool load(const string& path, bool useMmap) {
+
+#if defined(__linux__)
+        if (useMmap) {
+            int fd = ::open(path.c_str(), O_RDONLY);
+            if (fd < 0) {
+                return fail("не удалось открыть " + path);
+            }
+            struct stat info;
+            if (fstat(fd, &info) == 0 && info.st_size > 0) {
+                void* p = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+                if (p != MAP_FAILED) {
+                    data = static_cast<const char*>(p);
+                    length = static_cast<size_t>(info.st_size);
+                    mapped = true;
+                }
+            }
+            ::close(fd);
+            if (mapped) {
+                return true;
+            }
+        }
+#else
+        (void)useMmap;
+#endif
+
+        ifstream file(path, ios::binary);
+        if (!file) {
+            return fail("не удалось открыть " + path);
+        }
+        contents.assign(istreambuf_iterator<char>(file), istreambuf_iterator<char>());
+        data = contents.data();
+        length = contents.size();
+
+        return true;
+
+    }
+
+    template <class Record>
+    bool bind(const ShapeFileTypeEntry& entry, RecordRange<Record>& range) {
+
+        if (entry.recordSize != sizeof(Record) || entry.offset % alignof(Record) != 0
+            || entry.offset > length || entry.count > (length - entry.offset) / sizeof(Record)) {
+            return fail("поврежденная секция в таблице типов");
+        }
+        range = RecordRange<Record>(reinterpret_cast<const Record*>(data + entry.offset), static_cast<size_t>(entry.count));
+
+        return true;
+
+    }
+
+    bool parse() {
+
+        ShapeFileHeader header;
+        if (length < sizeof(header)) {
+            return fail("файл короче заголовка");
+        }
+        memcpy(&header, data, sizeof(header));
+        if (memcmp(header.magic, kShapeFileMagic, sizeof(header.magic)) != 0) {
+            return fail("это не файл фигур");
+        }
+        if (header.version != kShapeFileVersion) {
+            return fail("неподдерживаемая версия " + to_string(header.version));
+        }
+        if (header.typeCount > kShapeFileMaxTypes || header.fileSize != length
+            || length < sizeof(header) + header.typeCount * sizeof(ShapeFileTypeEntry)) {
+            return fail("поврежденный заголовок");
+        }
+
+        for (uint32_t i = 0; i < header.typeCount; ++i) {
+            ShapeFileTypeEntry entry;
+            memcpy(&entry, data + sizeof(header) + i * sizeof(entry), sizeof(entry));
+            bool ok = true;
+            switch (static_cast<ShapeType>(entry.type)) {
+            case ShapeType::Point:
+                ok = bind(entry, pointRange);
+                break;
+            case ShapeType::Circle:
+                ok = bind(entry, circleRange);
+                break;
+            case ShapeType::Rectangle:
+                ok = bind(entry, rectangleRange);
+                break;
+            default:
+                ok = fail("неизвестный тип в таблице типов");
+                break;
+            }
+            if (!ok) {
+                return false;
+            }
+        }
+
+        return true;
+
+    }
+
+    void release() {
+
+#if defined(__linux__)
+        if (mapped) {
+            munmap(const_cast<char*>(data), length);
+        }
+#endif
+        data = nullptr;
+        length = 0;
+        mapped = false;
+        contents.clear();
+
+    }
+
+public:
+
+    explicit ShapeFileView(const string& path, bool useMmap = true) {
+
+        if (!load(path, useMmap) || !parse()) {
+            release();
+            pointRange = {};
+            circleRange = {};
+            rectangleRange = {};
+        }
+
+    }
+
+    ~ShapeFileView() {
+
+        release();
+
+    }
+
+    ShapeFileView(const ShapeFileView&) = delete;
+    ShapeFileView& operator=(const ShapeFileView&) = delete;
+
+    bool ok() const { return errorText.empty(); }
+
+    const string& error() const { return errorText; }
+
+    bool isMapped() const { return mapped; }
+
+    size_t bytes() const { return length; }
+
+    const RecordRange<PointRecord>& points() const { return pointRange; }
+
+    const RecordRange<CircleRecord>& circles() const { return circleRange; }
+
+    const RecordRange<RectangleRecord>& rectangles() const { return rectangleRange; }
+
+    Point pointAt(size_t i) const { return Point(pointRange[i].x, pointRange[i].y); }
+
+    Circle circleAt(size_t i) const { return Circle(circleRange[i].x, circleRange[i].y, circleRange[i].radius); }
+
+    Rectangle rectangleAt(size_t i) const {
+        const RectangleRecord& r = rectangleRange[i];
+        return Rectangle(r.x1, r.y1, r.x2, r.y2);
+    }
+};
+
+// Запрос к набору фигур: сколько фигур задевают окно и суммарная площадь кругов и прямоугольников
+struct ShapeQueryResult {
+    size_t hits = 0;
+    double area = 0;
+};
+
+template <class Points, class Circles, class Rectangles>
+ShapeQueryResult queryShapes(const Points& points, const Circles& circles, const Rectangles& rects, int lo, int hi) {
+
+    ShapeQueryResult result;
+    for (const PointRecord& p : points) {
+        result.hits += p.x >= lo && p.x <= hi && p.y >= lo && p.y <= hi;
+    }
+    for (const CircleRecord& c : circles) {
+        result.hits += c.x >= lo && c.x <= hi && c.y >= lo && c.y <= hi;
+        result.area += 3.14159265358979 * c.radius * c.radius;
+    }
+    for (const RectangleRecord& r : rects) {
+        result.hits += r.x1 <= hi && r.x2 >= lo && r.y1 <= hi && r.y2 >= lo;
+        result.area += static_cast<double>(r.x2 - r.x1) * (r.y2 - r.y1);
+    }
+
+    return result;
+
+}
+
+// Замер: двоичный файл (mmap и чтение в буфер) против текстового формата "P x y" / "C x y r" / "R x1 y1 x2 y2"
+void benchmarkShapeFile(size_t n) {
+
+    lifecycle::ScopedMute mute;
+
+    const string binaryPath = "oop2_shapes.bin";
+    const string textPath = "oop2_shapes.txt";
+    const int world = 100000, lo = 40000, hi = 60000;
+
+    // Фигуры генерируются потоком прямо в файл, в памяти их нет; каждый проход повторяет ту же последовательность
+    auto generate = [&](auto&& sink) {
+        uint64_t seed = 777;
+        auto next = [&seed](int bound) {
+            seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+            return static_cast<int>((seed >> 33) % static_cast<uint64_t>(bound));
+        };
+        for (size_t i = 0; i < n; ++i) {
+            size_t kind = i * 3 / n; // Сначала точки, потом круги, потом прямоугольники
+            int x = next(world), y = next(world);
+            if (kind == 0) {
+                sink(PointRecord{ x, y });
+            }
+            else if (kind == 1) {
+                sink(CircleRecord{ x, y, 1 + next(400) / 4.0 }); // Радиус точно записывается в десятичном виде
+            }
+            else {
+                sink(RectangleRecord{ x, y, x + 1 + next(50), y + 1 + next(50) });
+            }
+        }
+    };
+
+    ShapeQueryResult expected;
+    generate([&](const auto& record) {
+        using Record = decay_t<decltype(record)>;
+        RecordRange<Record> one(&record, 1);
+        ShapeQueryResult r;
+        if constexpr (is_same_v<Record, PointRecord>) {
+            r = queryShapes(one, RecordRange<CircleRecord>(), RecordRange<RectangleRecord>(), lo, hi);
+        }
+        else if constexpr (is_same_v<Record, CircleRecord>) {
+            r = queryShapes(RecordRange<PointRecord>(), one, RecordRange<RectangleRecord>(), lo, hi);
+        }
+        else {
+            r = queryShapes(RecordRange<PointRecord>(), RecordRange<CircleRecord>(), one, lo, hi);
+        }
+        expected.hits += r.hits;
+        expected.area += r.area;
+    });
+
+    bench::Stopwatch timer;
+    ShapeFileWriter writer(binaryPath);
+    generate([&writer](const auto& record) { writer.add(record); });
+    bool written = writer.finish();
+    uint64_t binaryWriteNs = timer.elapsedNs();
+    if (!written) {
+        cout << "Не удалось записать " << binaryPath << endl;
+        return;
+    }
+
+    timer.restart();
+    {
+        ofstream text(textPath);
+        generate([&text](const auto& record) {
+            using Record = decay_t<decltype(record)>;
+            if constexpr (is_same_v<Record, PointRecord>) {
+                text << "P " << record.x << ' ' << record.y << '\n';
+            }
+            else if constexpr (is_same_v<Record, CircleRecord>) {
+                text << "C " << record.x << ' ' << record.y << ' ' << record.radius << '\n';
+            }
+            else {
+                text << "R " << record.x1 << ' ' << record.y1 << ' ' << record.x2 << ' ' << record.y2 << '\n';
+            }
+        });
+    }
+    uint64_t textWriteNs = timer.elapsedNs();
+
+    cout << "Фигур: " << n << " (поровну точек, кругов и прямоугольников)" << endl;
+    cout << "  запись: двоичный " << binaryWriteNs / 1000000 << " мс, текст " << textWriteNs / 1000000 << " мс" << endl;
+
+    auto report = [&](const char* title, uint64_t loadNs, uint64_t queryNs, size_t rssBeforeKb, size_t rssLoadedKb,
+        size_t rssQueriedKb, const ShapeQueryResult& result) {
+        cout << "  " << title << ": загрузка " << loadNs / 1000 << " мкс, первый запрос " << queryNs / 1000000 << " мс, RSS +"
+            << rssLoadedKb - rssBeforeKb << " КБ после загрузки, +" << rssQueriedKb - rssBeforeKb << " КБ после запроса, результат "
+            << (result.hits == expected.hits && result.area == expected.area ? "верный" : "НЕВЕРНЫЙ") << endl;
+    };
+
+    for (bool useMmap : { true, false }) {
+        bench::runIsolated([&] {
+            size_t rssBefore = bench::currentRssKb();
+            bench::Stopwatch watch;
+            ShapeFileView view(binaryPath, useMmap);
+            uint64_t loadNs = watch.elapsedNs();
+            size_t rssLoaded = bench::currentRssKb();
+            if (!view.ok()) {
+                cout << "  ошибка чтения: " << view.error() << endl;
+                return;
+            }
+            watch.restart();
+            ShapeQueryResult result = queryShapes(view.points(), view.circles(), view.rectangles(), lo, hi);
+            uint64_t queryNs = watch.elapsedNs();
+            report(view.isMapped() ? "двоичный, mmap" : "двоичный, чтение в буфер", loadNs, queryNs, rssBefore, rssLoaded,
+                bench::currentRssKb(), result);
+        });
+    }
+
+    bench::runIsolated([&] {
+        size_t rssBefore = bench::currentRssKb();
+        bench::Stopwatch watch;
+        vector<PointRecord> loadedPoints;
+        vector<CircleRecord> loadedCircles;
+        vector<RectangleRecord> loadedRects;
+        ifstream text(textPath);
+        char tag;
+        while (text >> tag) {
+            if (tag == 'P') {
+                PointRecord p;
+                text >> p.x >> p.y;
+                loadedPoints.push_back(p);
+            }
+            else if (tag == 'C') {
+                CircleRecord c;
+                text >> c.x >> c.y >> c.radius;
+                loadedCircles.push_back(c);
+            }
+            else {
+                RectangleRecord r;
+                text >> r.x1 >> r.y1 >> r.x2 >> r.y2;
+                loadedRects.push_back(r);
+            }
+        }
+        uint64_t loadNs = watch.elapsedNs();
+        size_t rssLoaded = bench::currentRssKb();
+        watch.restart();
+        ShapeQueryResult result = queryShapes(loadedPoints, loadedCircles, loadedRects, lo, hi);
+        uint64_t queryNs = watch.elapsedNs();
+        report("текст", loadNs, queryNs, rssBefore, rssLoaded, bench::currentRssKb(), result);
+    });
+
+    ifstream binarySize(binaryPath, ios::binary | ios::ate), textSize(textPath, ios::ate);
+    cout << "  размер: двоичный " << binarySize.tellg() / 1024 << " КБ, текст " << textSize.tellg() / 1024 << " КБ" << endl;
+    binarySize.close();
+    textSize.close();
+
+    remove(binaryPath.c_str());
+    remove(textPath.c_str());
+
+}
+
+// Пул потоков с кражей работы. У каждого исполнителя своя очередь задач: хозяин берет задачи
+// с конца, а опустевший исполнитель забирает их с начала чужой очереди. Вызывающий поток
+// в parallelFor работает как исполнитель 0, так что пул из одного потока - это обычный цикл
+class WorkStealingPool {
+
+private:
+
+    struct alignas(64) WorkerQueue {
+        mutex lock;
+        deque<size_t> tasks;
+    };
+
+    vector<unique_ptr<WorkerQueue>> queues;
+    vector<thread> threads;
+
+    mutex jobMutex;
+    condition_variable jobReady;
+    condition_variable jobDone;
+    const function<void(size_t)>* job = nullptr;
+    uint64_t jobGeneration = 0;
+    size_t busy = 0; // Исполнителей, взявших текущую задачу
+    bool stopping = false;
+
+    bool popLocal(size_t worker, size_t& task) {
+
+        WorkerQueue& queue = *queues[worker];
+        lock_guard<mutex> guard(queue.lock);
+        if (queue.tasks.empty()) {
+            return false;
+        }
+        task = queue.tasks.back();
+        queue.tasks.pop_back();
+
+        return true;
+
+    }
+
+    bool steal(size_t worker, size_t& task) {
+
+        for (size_t i = 1; i < queues.size(); ++i) {
+            WorkerQueue& victim = *queues[(worker + i) % queues.size()];
+            lock_guard<mutex> guard(victim.lock);
+            if (!victim.tasks.empty()) {
+                task = victim.tasks.front();
+                victim.tasks.pop_front();
+                return true;
+            }
+        }
+
+        return false;
+
+    }
+
+    void work(size_t worker, const function<void(size_t)>& fn) {
+
+        size_t task;
+        while (popLocal(worker, task) || steal(worker, task)) {
+            fn(task);
+        }
+
+    }
+
+    void workerLoop(size_t worker) {
+
+        uint64_t seen = 0;
+        unique_lock<mutex> lock(jobMutex);
+        for (;;) {
+            jobReady.wait(lock, [&] { return stopping || jobGeneration != seen; });
+            if (stopping) {
+                return;
+            }
+            seen = jobGeneration;
+            const function<void(size_t)>* fn = job;
+            if (!fn) {
+                continue; // Задача уже завершилась, пока поток просыпался
+            }
+            ++busy;
+            lock.unlock();
+            work(worker, *fn);
+            lock.lock();
+            if (--busy == 0) {
+                jobDone.notify_all();
+            }
+        }
+
+    }
+
+public:
+
+    explicit WorkStealingPool(size_t threadCount) {
+
+        threadCount = max<size_t>(threadCount, 1);
+        for (size_t i = 0; i < threadCount; ++i) {
+            queues.push_back(make_unique<WorkerQueue>());
+        }
+        for (size_t i = 1; i < threadCount; ++i) {
+            threads.emplace_back([this, i] { workerLoop(i); });
+        }
+
+    }
+
+    ~WorkStealingPool() {
+
+        {
+            lock_guard<mutex> guard(jobMutex);
+            stopping = true;
+        }
+        jobReady.notify_all();
+        for (thread& t : threads) {
+            t.join();
+        }
+
+    }
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    size_t size() const { return queues.size(); }
+
+    // Выполняет fn(0) ... fn(taskCount - 1) и ждет завершения всех задач.
+    // Задачи раздаются исполнителям непрерывными блоками, дальше балансирует кража
+    void parallelFor(size_t taskCount, const function<void(size_t)>& fn) {
+
+        for (size_t w = 0; w < queues.size(); ++w) {
+            lock_guard<mutex> guard(queues[w]->lock);
+            for (size_t t = w * taskCount / queues.size(); t < (w + 1) * taskCount / queues.size(); ++t) {
+                queues[w]->tasks.push_back(t);
+            }
+        }
+
+        {
+            lock_guard<mutex> guard(jobMutex);
+            job = &fn;
+            ++jobGeneration;
+        }
+        jobReady.notify_all();
+
+        work(0, fn);
+
+        unique_lock<mutex> lock(jobMutex);
+        jobDone.wait(lock, [this] { return busy == 0; });
+        job = nullptr;
+
+    }
+
+    void run(size_t taskCount, const function<void(size_t)>& fn) { parallelFor(taskCount, fn); }
+};
+
+// Последовательный исполнитель с тем же интерфейсом (эталон для проверки)
+struct SequentialExecutor {
+
+    void run(size_t taskCount, const function<void(size_t)>& fn) {
+        for (size_t t = 0; t < taskCount; ++t) {
+            fn(t);
+        }
+    }
+};
+
+#if defined(OOP2_USE_PSTL)
+// Исполнитель на параллельных алгоритмах стандартной библиотеки (в libstdc++ нужен TBB: -DOOP2_USE_PSTL -ltbb)
+struct PstlExecutor {
+
+    void run(size_t taskCount, const function<void(size_t)>& fn) {
+        vector<size_t> tasks(taskCount);
+        iota(tasks.begin(), tasks.end(), size_t(0));
+        for_each(execution::par, tasks.begin(), tasks.end(), [&fn](size_t t) { fn(t); });
+    }
+};
+#endif
+
+// Размер куска не зависит от числа потоков: частичные результаты считаются по кускам
+// и сводятся в порядке кусков, поэтому итог (в том числе сумма double) одинаков при любом числе потоков
+const size_t kBulkChunk = 16384;
+
+template <class Executor, class Fn>
+size_t forEachChunk(Executor& executor, size_t n, Fn&& fn) {
+
+    size_t chunks = (n + kBulkChunk - 1) / kBulkChunk;
+    executor.run(chunks, [&](size_t c) { fn(c, c * kBulkChunk, min(n, (c + 1) * kBulkChunk)); });
+
+    return chunks;
+
+}
+
+// Упорядочивает углы всех прямоугольников
+template <class Executor>
+void bulkNormalize(vector<Rectangle>& rects, Executor& executor) {
+
+    forEachChunk(executor, rects.size(), [&rects](size_t, size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            rects[i].normalize();
+        }
+    });
+
+}
+
+// Общая ограничивающая рамка
+template <class Executor>
+BoundingBox bulkBounds(const vector<Rectangle>& rects, Executor& executor) {
+
+    vector<BoundingBox> partial((rects.size() + kBulkChunk - 1) / kBulkChunk);
+    forEachChunk(executor, rects.size(), [&](size_t c, size_t begin, size_t end) {
+        BoundingBox box;
+        for (size_t i = begin; i < end; ++i) {
+            const Point& a = rects[i].getTopLeft();
+            const Point& b = rects[i].getBottomRight();
+            double minX = min(a.getX(), b.getX()), maxX = max(a.getX(), b.getX());
+            double minY = min(a.getY(), b.getY()), maxY = max(a.getY(), b.getY());
+            if (box.empty) {
+                box = { minX, minY, maxX, maxY, false };
+            }
+            else {
+                box = { min(box.minX, minX), min(box.minY, minY), max(box.maxX, maxX), max(box.maxY, maxY), false };
+            }
+        }
+        partial[c] = box;
+    });
+
+    BoundingBox total;
+    for (const BoundingBox& box : partial) {
+        if (box.empty) {
+            continue;
+        }
+        if (total.empty) {
+            total = box;
+        }
+        else {
+            total = { min(total.minX, box.minX), min(total.minY, box.minY), max(total.maxX, box.maxX), max(total.maxY, box.maxY), false };
+        }
+    }
+
+    return total;
+
+}
+
+// Сумма площадей
+template <class Executor>
+double bulkArea(const vector<Rectangle>& rects, Executor& executor) {
+
+    vector<double> partial((rects.size() + kBulkChunk - 1) / kBulkChunk);
+    forEachChunk(executor, rects.size(), [&](size_t c, size_t begin, size_t end) {
+        double sum = 0;
+        for (size_t i = begin; i < end; ++i) {
+            sum += rects[i].area();
+        }
+        partial[c] = sum;
+    });
+
+    double total = 0;
+    for (double sum : partial) {
+        total += sum;
+    }
+
+    return total;
+
+}
+
+// Индексы прямоугольников, пересекающихся с окном, в порядке возрастания
+template <class Executor>
+vector<size_t> bulkOverlaps(const vector<Rectangle>& rects, const Rectangle& window, Executor& executor) {
+
+    vector<vector<size_t>> partial((rects.size() + kBulkChunk - 1) / kBulkChunk);
+    forEachChunk(executor, rects.size(), [&](size_t c, size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            if (rects[i].overlaps(window)) {
+                partial[c].push_back(i);
+            }
+        }
+    });
+
+    vector<size_t> result;
+    for (const vector<size_t>& hits : partial) {
+        result.insert(result.end(), hits.begin(), hits.end());
+    }
+
+    return result;
+
+}
+
+// Замер: пакетные операции над прямоугольниками на 1, 2, 4, ... потоках против последовательного прохода
+void benchmarkParallelBulk(size_t n, size_t maxThreads) {
+
+    lifecycle::ScopedMute mute;
+
+    vector<Rectangle> original;
+    original.reserve(n);
+    uint64_t seed = 4242;
+    auto next = [&seed](int bound) {
+        seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+        return static_cast<int>((seed >> 33) % static_cast<uint64_t>(bound));
+    };
+    for (size_t i = 0; i < n; ++i) {
+        int x = next(1000000), y = next(1000000);
+        int w = 1 + next(100), h = 1 + next(100);
+        if (next(2)) {
+            original.emplace_back(x + w, y + h, x, y); // Углы перепутаны, их исправит нормализация
+        }
+        else {
+            original.emplace_back(x, y, x + w, y + h);
+        }
+    }
+    Rectangle window(400000, 400000, 600000, 600000);
+
+    struct Outcome {
+        vector<Rectangle> rects;
+        BoundingBox bounds;
+        double area;
+        vector<size_t> overlaps;
+        uint64_t ns[4];
+    };
+
+    auto runAll = [&](auto& executor) {
+        Outcome out{ original, {}, 0, {}, {} };
+        bench::Stopwatch timer;
+        bulkNormalize(out.rects, executor);
+        out.ns[0] = timer.elapsedNs();
+        timer.restart();
+        out.bounds = bulkBounds(out.rects, executor);
+        out.ns[1] = timer.elapsedNs();
+        timer.restart();
+        out.area = bulkArea(out.rects, executor);
+        out.ns[2] = timer.elapsedNs();
+        timer.restart();
+        out.overlaps = bulkOverlaps(out.rects, window, executor);
+        out.ns[3] = timer.elapsedNs();
+        return out;
+    };
+
+    auto sameRects = [](const vector<Rectangle>& a, const vector<Rectangle>& b) {
+        for (size_t i = 0; i < a.size(); ++i) {
+            if (a[i].getTopLeft().getX() != b[i].getTopLeft().getX() || a[i].getTopLeft().getY() != b[i].getTopLeft().getY()
+                || a[i].getBottomRight().getX() != b[i].getBottomRight().getX() || a[i].getBottomRight().getY() != b[i].getBottomRight().getY()) {
+                return false;
+            }
+        }
+        return a.size() == b.size();
+    };
+
+    auto report = [&](const string& title, const Outcome& out, const Outcome& reference) {
+        bool same = out.bounds == reference.bounds && out.area == reference.area && out.overlaps == reference.overlaps
+            && sameRects(out.rects, reference.rects);
+        cout << "  " << title << ": нормализация " << out.ns[0] / 1000000.0 << " мс, рамка " << out.ns[1] / 1000000.0
+            << " мс, площадь " << out.ns[2] / 1000000.0 << " мс, пересечения " << out.ns[3] / 1000000.0 << " мс, ускорение x"
+            << static_cast<double>(reference.ns[0] + reference.ns[1] + reference.ns[2] + reference.ns[3])
+                / (out.ns[0] + out.ns[1] + out.ns[2] + out.ns[3])
+            << ", результаты " << (same ? "совпадают" : "НЕ СОВПАДАЮТ") << endl;
+    };
+
+    SequentialExecutor sequential;
+    Outcome reference = runAll(sequential);
+
+    cout << "Прямоугольников: " << n << ", кусок " << kBulkChunk << ", ядер: " << thread::hardware_concurrency() << endl;
+    cout << "  площадь " << reference.area << ", пересекают окно: " << reference.overlaps.size() << endl;
+    report("последовательно", reference, reference);
+
+    for (size_t threads = 1; threads <= maxThreads; threads *= 2) {
+        WorkStealingPool pool(threads);
+        report("пул, потоков " + to_string(threads), runAll(pool), reference);
+    }
+
+#if defined(OOP2_USE_PSTL)
+    PstlExecutor pstl;
+    report("execution::par", runAll(pstl), reference);
+#endif
+
+}
+
+// Самопроверка CowRectangle: OOP2 check. Возвращает число ошибок
+int runSelfCheck() {
+
+    lifecycle::ScopedMute mute;
+    int failures = 0;
+    auto expect = [&failures](bool condition, const char* what) {
+        cout << (condition ? "  ok    " : "  FAIL  ") << what << endl;
+        failures += condition ? 0 : 1;
+    };
+    auto corners = [](const CowRectangle& r) {
+        return vector<int>{ r.getTopLeft().getX(), r.getTopLeft().getY(), r.getBottomRight().getX(), r.getBottomRight().getY() };
+    };
+
+    cout << "Самопроверка CowRectangle" << endl;
+
+    CowRectangle original(1, 2, 3, 4);
+    {
+        alloc_hooks::AllocScope allocations;
+        CowRectangle copy(original);
+        CowRectangle assigned(9, 9, 9, 9);
+        alloc_hooks::AllocScope afterConstruct;
+        assigned = copy;
+        expect(afterConstruct.delta().allocations == 0 && assigned.sharesWith(original) && original.useCount() == 3,
+            "копирование и присваивание делят блок углов без выделений");
+        expect(allocations.delta().frees == 1, "старый блок освобождается при присваивании");
+
+        alloc_hooks::AllocScope firstWrite;
+        copy.setTopLeft(10, 20);
+        expect(firstWrite.delta().allocations == 1 && !copy.sharesWith(original) && original.useCount() == 2,
+            "первая запись делает свою копию блока");
+        expect(corners(copy) == vector<int>{ 10, 20, 3, 4 } && corners(original) == vector<int>{ 1, 2, 3, 4 }
+            && corners(assigned) == vector<int>{ 1, 2, 3, 4 }, "запись в копию не видна в оригинале и других копиях");
+
+        alloc_hooks::AllocScope secondWrite;
+        copy.setBottomRight(30, 40);
+        expect(secondWrite.delta().allocations == 0 && corners(copy) == vector<int>{ 10, 20, 30, 40 }, "повторная запись идет в свой блок без выделений");
+    }
+    expect(original.useCount() == 1, "после уничтожения копий блок снова принадлежит одному объекту");
+
+    {
+        alloc_hooks::AllocScope ownWrite;
+        original.setTopLeft(5, 6);
+        expect(ownWrite.delta().allocations == 0 && corners(original) == vector<int>{ 5, 6, 3, 4 }, "запись в необщий блок идет на месте");
+    }
+
+    CowRectangle& self = original;
+    original = self;
+    expect(original.useCount() == 1 && corners(original) == vector<int>{ 5, 6, 3, 4 }, "самоприсваивание ничего не меняет");
+
+    CowRectangle moved(move(original));
+    expect(original.useCount() == 0 && moved.useCount() == 1 && corners(moved) == vector<int>{ 5, 6, 3, 4 }, "перемещение передает блок");
+    original.setBottomRight(7, 8);
+    expect(corners(original) == vector<int>{ 0, 0, 7, 8 }, "запись в перемещенный объект создает новый блок");
+
+    // Читатели в разных потоках держат копии общего блока, пока главный поток пишет в свою
+    CowRectangle shared(100, 200, 300, 400);
+    atomic<bool> consistent{ true };
+    vector<thread> readers;
+    for (int t = 0; t < 4; ++t) {
+        readers.emplace_back([&shared, &consistent, &corners] {
+            for (int i = 0; i < 2000; ++i) {
+                CowRectangle local(shared);
+                if (corners(local) != vector<int>{ 100, 200, 300, 400 }) {
+                    consistent = false;
+                }
+            }
+        });
+    }
+    CowRectangle writer(shared);
+    for (int i = 0; i < 2000; ++i) {
+        writer.setTopLeft(i, i);
+    }
+    for (thread& t : readers) {
+        t.join();
+    }
+    expect(consistent && shared.useCount() == 1 && !writer.sharesWith(shared) && corners(shared) == vector<int>{ 100, 200, 300, 400 },
+        "одновременные читатели видят неизменный общий блок");
+
+    cout << (failures == 0 ? "Все проверки пройдены" : "Есть ошибки") << endl;
+
+    return failures;
+
+}
+
+// Замер: снимки массива прямоугольников (много копий, мало записей)
+void benchmarkCow(size_t n) {
+
+    lifecycle::ScopedMute mute;
+
+    const int snapshots = 8;
+
+    vector<RectanglePtr> pointers;
+    vector<Rectangle> values;
+    vector<CowRectangle> cows;
+    pointers.reserve(n);
+    values.reserve(n);
+    cows.reserve(n);
+    for (size_t i = 0; i < n; ++i) {
+        int v = static_cast<int>(i % 100000);
+        pointers.emplace_back(v, v, v + 10, v + 20);
+        values.emplace_back(v, v, v + 10, v + 20);
+        cows.emplace_back(v, v, v + 10, v + 20);
+    }
+
+    // Снимок: копия всего массива и проход чтения по ней
+    auto snapshotRun = [&](const char* title, const auto& source) {
+        using Vec = decay_t<decltype(source)>;
+        alloc_hooks::AllocScope allocations;
+        uint64_t copyNs = 0, readNs = 0;
+        int64_t checksum = 0;
+        for (int s = 0; s < snapshots; ++s) {
+            bench::Stopwatch timer;
+            Vec snapshot(source);
+            copyNs += timer.elapsedNs();
+            timer.restart();
+            for (const auto& r : snapshot) {
+                checksum += r.getTopLeft().getX() + r.getBottomRight().getY();
+            }
+            readNs += timer.elapsedNs();
+        }
+        double copies = static_cast<double>(n) * snapshots;
+        cout << "  " << title << ": копия " << copyNs / copies << " нс, чтение " << readNs / copies << " нс, выделений на копию "
+            << (allocations.delta().allocations - snapshots) / copies << endl; // Без буферов самих векторов
+        return checksum;
+    };
+
+    cout << "Прямоугольников: " << n << ", снимков: " << snapshots << endl;
+    int64_t a = snapshotRun("RectanglePtr (глубокая копия)", pointers);
+    int64_t b = snapshotRun("Rectangle (значение)", values);
+    int64_t c = snapshotRun("CowRectangle (общие углы)", cows);
+
+    // Запись в каждый сотый прямоугольник снимка: первая запись копирует блок, вторая - нет
+    vector<CowRectangle> snapshot(cows);
+    alloc_hooks::AllocScope allocations;
+    bench::Stopwatch timer;
+    for (size_t i = 0; i < n; i += 100) {
+        snapshot[i].setTopLeft(-1, -1);
+    }
+    uint64_t firstNs = timer.elapsedNs();
+    uint64_t firstAllocs = allocations.delta().allocations;
+    timer.restart();
+    for (size_t i = 0; i < n; i += 100) {
+        snapshot[i].setBottomRight(1, 1);
+    }
+    uint64_t secondNs = timer.elapsedNs();
+    double writes = static_cast<double>((n + 99) / 100);
+    cout << "  CowRectangle, запись в 1% снимка: первая " << firstNs / writes << " нс (выделений " << firstAllocs / writes
+        << "), повторная " << secondNs / writes << " нс" << endl;
+
+    bool untouched = cows[0].getTopLeft().getX() == 0 && !snapshot[0].sharesWith(cows[0]) && snapshot[1].sharesWith(cows[1]);
+    cout << "  контрольные суммы " << (a == b && b == c ? "совпадают" : "НЕ СОВПАДАЮТ") << ", исходный массив "
+        << (untouched ? "не изменился" : "ИЗМЕНИЛСЯ") << endl;
+
+}
+
+// Число повторов из аргумента: только цифры целиком, без знака и переполнения
+bool parseIterations(const string& text, size_t& iterations) {
+
+    const char* end = text.data() + text.size();
+    auto [ptr, ec] = from_chars(text.data(), end, iterations);
+    if (ec != errc() || ptr != end) {
+
+        cerr << "Неверное число повторов '" << text << "'" << endl;
+        return false;
+
+    }
+    return true;
+
+}
+
+// Запуск замеров из командной строки: OOP2 bench <имя> [количество элементов]
+int runBenchmark(int argc, char* argv[]) {
+
+    string name = argc > 2 ? argv[2] : "";
+    size_t n = 1000000;
+    if (argc > 3 && !parseIterations(argv[3], n)) {
+        return 1;
+    }
+    if (n == 0) {
+        cerr << "Количество элементов должно быть больше нуля" << endl;
+        return 1;
+    }
+
+    if (name == "soa") {
+        benchmarkSoA(n);
+        return 0;
+    }
+
+    if (name == "pool") {
+        benchmarkPointPool(n);
+        return 0;
+    }
+
+    if (name == "growth") {
+        benchmarkGrowth(n);
+        return 0;
+    }
+
+    if (name == "spatial") {
+        benchmarkSpatialIndex(n);
+        return 0;
+    }
+
+    if (name == "file") {
+        benchmarkShapeFile(argc > 3 ? n : 3000000);
+        return 0;
+    }
+
+    if (name == "parallel") {
+        size_t threads = max<size_t>(thread::hardware_concurrency(), 1);
+        if (argc > 4 && !parseIterations(argv[4], threads)) {
+            return 1;
+        }
+        benchmarkParallelBulk(argc > 3 ? n : 2000000, threads);
+        return 0;
+    }
+
+    if (name == "cow") {
+        benchmarkCow(n);
+        return 0;
+    }
+
+    if (name == "variant") {
+        benchmarkVariant(argc > 3 ? n : 10000000);
+        return 0;
+    }
+
+    cout << "Неизвестный замер '" << name << "'. Доступные: soa, pool, growth, variant, spatial, file, parallel, cow" << endl;
+
+    return 1;
+
+}
+
+// Сценарии меню: каждый можно вызвать из меню или из пакетного прогона
+
+void scenarioStatic() {
+    cout << "Статическое создание объектов" << endl << endl;
+
+    // Создание объекта класса Point
+    Point point(10, 20);
+    point.print();
+    cout << endl;
+}
+
+void scenarioDynamic() {
+
+    cout << "Динамическое создание объектов" << endl << endl;
+
+    // Динамическое создание объекта класса Circle
+    Circle* circle = new Circle(30, 40, 5.5);
+    circle->print();
+    cout << endl;
+
+    delete circle;
+}
+
+void scenarioAssignment() {
+
+    cout << "Присваивание значения объектов" << endl << endl;
+
+    // Rectangle
+    Rectangle rectangle1(0, 0, 1, 1); // Создаем объект с временными значениями
+    Rectangle rectangle2(5, 5, 25, 25); // Создаем временный объект
+    rectangle1 = rectangle2; // Присваиваем значение
+    rectangle1.print();
+    cout << endl;
+}
+
+void scenarioPolymorphism() {
+
+    cout << "Полиморфизм объектов" << endl << endl;
+
+
+    // Указатель на базовый класс указывает на объект производного класса
+    Point* ptr = new Circle(7, 8, 9.9);
+
+    // Вызов метода print() производного класса благодаря полиморфизму
+    ptr->print();
+    cout << endl;
+
+    // Освобождение памяти
+    delete ptr;
+}
+
+void scenarioCopyConstructor() {
+
+    cout << "Конструктор копирования объектов" << endl << endl;
+
+    RectanglePtr rp1(1, 2, 3, 4);
+    RectanglePtr rp2 = rp1; // Использование конструктора копирования
+    rp1.print();
+    rp2.print();
+    cout << endl;
+}
+
+struct Scenario {
+    int choice;        // Пункт меню
+    const char* name;  // Имя для пакетного прогона
+    void (*run)();
+};
+
+const Scenario scenarios[] = {
+    { 1, "static", scenarioStatic },
+    { 2, "dynamic", scenarioDynamic },
+    { 3, "assign", scenarioAssignment },
+    { 4, "poly", scenarioPolymorphism },
+    { 5, "copy", scenarioCopyConstructor },
+};
+
+const Scenario* findScenario(const string& name) {
+    for (const Scenario& s : scenarios) {
+        if (name == s.name || name == to_string(s.choice)) {
+            return &s;
+        }
+    }
+    return nullptr;
+}
+
+struct ScenarioResult {
+    string name;
+    size_t iterations;
+    double nsPerOp;
+    double allocsPerOp;
+    double bytesPerOp;
+};
+
+// Прогоняет сценарий iterations раз; вывод (и трассировка) форматируется, но уходит в никуда
+ScenarioResult measureScenario(const Scenario& scenario, size_t iterations) {
+
+    bench::MuteStream quiet(cout);
+
+    scenario.run(); // Прогрев
+
+    alloc_hooks::AllocScope allocs;
+    bench::Stopwatch timer;
+    for (size_t i = 0; i < iterations; ++i) {
+        scenario.run();
+    }
+    uint64_t ns = timer.elapsedNs();
+    alloc_hooks::AllocStats d = allocs.delta();
+
+    double count = static_cast<double>(iterations);
+    return { scenario.name, iterations, ns / count, d.allocations / count, d.bytes / count };
+}
+
+// Пакетный прогон сценариев меню без ввода с клавиатуры:
+//   OOP2 run [--iterations N] [--format csv|json] [--file список] [сценарий[=N] ...]
+// Сценарии - имена (static, dynamic, assign, poly, copy) или номера пунктов меню.
+// В файле - по сценарию в строке, "имя [N]"; пустые строки и строки с # пропускаются.
+// Без сценариев прогоняются все
+int runScenarios(int argc, char* argv[]) {
+
+    size_t defaultIterations = 100000;
+    string format = "csv";
+    vector<pair<string, size_t>> requested; // Имя и число повторов (0 - по умолчанию)
+
+    for (int i = 2; i < argc; ++i) {
+        string arg = argv[i];
+        if ((arg == "--iterations" || arg == "-n") && i + 1 < argc) {
+            if (!parseIterations(argv[++i], defaultIterations)) {
+                return 1;
+            }
+            if (defaultIterations == 0) {
+                cerr << "Число повторов должно быть больше нуля" << endl;
+                return 1;
+            }
+        }
+        else if (arg == "--format" && i + 1 < argc) {
+            format = argv[++i];
+        }
+        else if (arg == "--file" && i + 1 < argc) {
+            ifstream file(argv[++i]);
+            if (!file) {
+                cerr << "Не удалось открыть файл сценариев " << argv[i] << endl;
+                return 1;
+            }
+            string line;
+            while (getline(file, line)) {
+                istringstream words(line);
+                string name;
+                string count;
+                size_t iterations = 0;
+                if (!(words >> name) || name[0] == '#') {
+                    continue;
+                }
+                if (words >> count && !parseIterations(count, iterations)) {
+                    return 1;
+                }
+                requested.push_back({ name, iterations });
+            }
+        }
+        else {
+            size_t eq = arg.find('=');
+            size_t iterations = 0;
+            if (eq != string::npos && !parseIterations(arg.substr(eq + 1), iterations)) {
+                return 1;
+            }
+            requested.push_back({ arg.substr(0, eq), iterations });
+        }
+    }
+
+    if (format != "csv" && format != "json") {
+        cerr << "Неизвестный формат '" << format << "'. Доступные: csv, json" << endl;
+        return 1;
+    }
+
+    if (requested.empty()) {
+        for (const Scenario& s : scenarios) {
+            requested.push_back({ s.name, 0 });
+        }
+    }
+
+    vector<ScenarioResult> results;
+    for (const auto& [name, iterations] : requested) {
+        const Scenario* scenario = findScenario(name);
+        if (!scenario) {
+            cerr << "Неизвестный сценарий '" << name << "'. Доступные: static, dynamic, assign, poly, copy" << endl;
+            return 1;
+        }
+        results.push_back(measureScenario(*scenario, iterations ? iterations : defaultIterations));
+    }
+
+    if (format == "csv") {
+        cout << "scenario,iterations,ns_per_op,allocs_per_op,bytes_per_op" << endl;
+        for (const ScenarioResult& r : results) {
+            cout << r.name << ',' << r.iterations << ',' << r.nsPerOp << ',' << r.allocsPerOp << ',' << r.bytesPerOp << endl;
+        }
+    }
+    else {
+        cout << "[" << endl;
+        for (size_t i = 0; i < results.size(); ++i) {
+            const ScenarioResult& r = results[i];
+            cout << "  {\"scenario\": \"" << r.name << "\", \"iterations\": " << r.iterations
+                << ", \"ns_per_op\": " << r.nsPerOp << ", \"allocs_per_op\": " << r.allocsPerOp
+                << ", \"bytes_per_op\": " << r.bytesPerOp << "}" << (i + 1 < results.size() ? "," : "") << endl;
+        }
+        cout << "]" << endl;
+    }
+
+    return 0;
+
+}
+
+int main(int argc, char* argv[]) {
+
+    setlocale(LC_ALL, "RU"); // Установка локали для корректного вывода русских символов
+
+    if (argc > 1 && string(argv[1]) == "bench") {
+
+        return runBenchmark(argc, argv); // Неинтерактивный режим замеров
+
+    }
+
+    if (argc > 1 && string(argv[1]) == "check") {
+
+        return runSelfCheck() == 0 ? 0 : 1; // Самопроверка копирования при записи
+
+    }
+
+    if (argc > 1 && string(argv[1]) == "run") {
+
+        return runScenarios(argc, argv); // Пакетный прогон сценариев меню
+
+    }
+
+    int choice;
+
+    while (true) {
+        cout << "Выберите пример для выполнения(1 - 5, 0 для выхода) : " << endl << endl;
+
+        cin >> choice;
+
+        if (!cin || choice == 0) {
+
+            return 0;
+
+        }
+
+        const Scenario* scenario = findScenario(to_string(choice));
+
+        if (scenario) {
+            scenario->run();
+        }
+        else {
+            cout << "Неверный выбор. Попробуйте снова." << endl;
         }
     }
 
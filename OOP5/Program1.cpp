@@ -1,43 +1,90 @@
 #include <iostream>
 #include <string>
 #include <clocale> // Для setlocale
+#include <vector>
+#include <memory>
+#include <sstream>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
+#include <cstdint>
+#include <string_view>
+
+#include "../Common/Bench.h"
+#include "../Common/BoundedQueue.h"
+#include "../Common/LifecycleTrace.h"
+#include "../Common/NameBuilder.h"
 
 using namespace std;
 
+// Точный тип объекта для таблицы операций kFoodOps
+enum FoodKind : unsigned char { kKindFood = 0, kKindFruit = 1, kKindCount = 2 };
+
 // Базовый класс: Еда
 class Food {
+private:
+    FoodKind kind; // Задается только конструктором
+
+protected:
+    // Конструктор для потомков: каждый передает свой точный тип
+    Food(string n, FoodKind k) : kind(k), name(move(n)) {
+        LIFECYCLE_TRACE("Конструктор Food: Создан объект '" << name << "'"); 
+    }
+
 public:
     string name; // Поле класса
 
-    // Конструктор Food: Инициализация члена 'name' через присваивание в теле
-    Food(string n = "Какая-то еда") {
-        this->name = n;
-        cout << "Конструктор Food: Создан объект '" << name << "'" << endl; 
+    // Конструктор Food: имя принимается по значению и перемещается в поле
+    // (для rvalue-строки память не выделяется, для lvalue - одна копия)
+    Food(string n = "Какая-то еда") : Food(move(n), kKindFood) {}
+
+    // Имя из string_view
+    explicit Food(string_view n) : Food(string(n)) {}
+
+    // Имя из литерала, буфера char или const char*: строка до первого нуля (nullptr не подходит)
+    template <class T, enable_if_t<names::isCString<T>, int> = 0>
+    Food(const T& n) : Food(string(n)) {}
+
+    // Точный тип объекта
+    FoodKind getKind() const {
+        return kind;
     }
 
     // Невиртуальный метод (перекрываемый)
-    void chop() {
-        cout << "Food::chop(): Нарезаем '" << name << "' базовым способом." << endl; 
+    void chop(ostream& out = cout) {
+        out << "Food::chop(): Нарезаем '" << name << "' базовым способом." << endl; 
     }
 
     // Виртуальный метод (переопределяемый)
-    virtual void taste() {
-        cout << "Food::taste(): Пробуем '" << name << "'. Вкус неопределенный." << endl; 
+    virtual void taste(ostream& out = cout) {
+        out << "Food::taste(): Пробуем '" << name << "'. Вкус неопределенный." << endl; 
     }
 
     // Метод, вызывающий другие методы этого класса
-    void prepareAndTaste() {
-        cout << endl << "Вызов методов из Food::prepareAndTaste() для '" << name << "':" << endl; 
-        cout << "  Вызов chop(): ";
-        chop(); // chop() сам выводит endl
-        cout << "  Вызов taste(): ";
-        taste(); // taste() сам выводит endl
-        cout << "Завершение Food::prepareAndTaste()" << endl; 
+    void prepareAndTaste(ostream& out = cout) {
+        beginPrepare(out);
+        finishPrepare(out);
+    }
+
+    // Первая половина prepareAndTaste(): заголовок и нарезка (стадия chop конвейера)
+    void beginPrepare(ostream& out) {
+        out << endl << "Вызов методов из Food::prepareAndTaste() для '" << name << "':" << endl; 
+        out << "  Вызов chop(): ";
+        chop(out); // chop() сам выводит endl
+    }
+
+    // Вторая половина prepareAndTaste(): дегустация (стадия taste конвейера)
+    void finishPrepare(ostream& out) {
+        out << "  Вызов taste(): ";
+        taste(out); // taste() сам выводит endl
+        out << "Завершение Food::prepareAndTaste()" << endl; 
     }
 
     // Виртуальный деструктор
     virtual ~Food() {
-        cout << "Деструктор Food: Уничтожен объект '" << name << "'" << endl; 
+        LIFECYCLE_TRACE("Деструктор Food: Уничтожен объект '" << name << "'"); 
     }
 };
 
@@ -49,36 +96,584 @@ public:
     bool peeled = false; // Поле класса Fruit
 
     // Конструктор Fruit: Инициализация базового класса ДОЛЖНА остаться в списке
-    Fruit(string n = "Какой-то фрукт") : Food(n) { // <-- Вызов конструктора БАЗОВОГО КЛАССА остается здесь!
-        cout << "Конструктор Fruit: Создан объект '" << name << "'" << endl; 
+    Fruit(string n = "Какой-то фрукт") : Food(move(n), kKindFruit) { // <-- Вызов конструктора БАЗОВОГО КЛАССА остается здесь!
+        LIFECYCLE_TRACE("Конструктор Fruit: Создан объект '" << name << "'"); 
     }
 
+    explicit Fruit(string_view n) : Fruit(string(n)) {}
+
+    template <class T, enable_if_t<names::isCString<T>, int> = 0>
+    Fruit(const T& n) : Fruit(string(n)) {}
+
     // Перекрытие невиртуального метода
-    void chop() {
-        cout << "Fruit::chop(): Нарезали '" << name << "'." << endl; 
+    void chop(ostream& out = cout) {
+        out << "Fruit::chop(): Нарезали '" << name << "'." << endl; 
     }
 
     // Переопределение виртуального метода
-    void taste() override {
-        cout << "Fruit::taste(): Пробуем фрукт " << name << endl; 
+    void taste(ostream& out = cout) override {
+        out << "Fruit::taste(): Пробуем фрукт " << name << endl; 
     }
 
     // Специфичный метод Fruit
-    void peel() {
+    void peel(ostream& out = cout) {
         peeled = true;
-        cout << "Fruit::peel(): Чистим фрукт '" << name << endl; 
+        out << "Fruit::peel(): Чистим фрукт '" << name << endl; 
     }
 
     // Деструктор Fruit
     ~Fruit() override {
-        cout << "Деструктор Fruit: Выбросили '" << name << "'" << endl; 
+        LIFECYCLE_TRACE("Деструктор Fruit: Выбросили '" << name << "'"); 
+    }
+};
+
+// Таблица операций по точному типу: вручную собранная "vtable" в плоском массиве [тип][операция].
+// Каждая функция обрабатывает целую серию объектов одного типа, и внутри серии вызовы
+// T::chop/T::taste статические (их можно встроить), так что косвенный вызов делается один раз
+// на серию, а не на объект. chop через таблицу вызывается для точного типа объекта,
+// то есть ведет себя как виртуальный - в отличие от chop() через указатель Food*
+enum FoodOp : unsigned char { kOpChop = 0, kOpTaste = 1, kOpCount = 2 };
+
+using FoodRunFn = void (*)(Food* const* items, size_t count, ostream& out);
+
+template <class T>
+void chopRun(Food* const* items, size_t count, ostream& out) {
+    for (size_t i = 0; i < count; ++i) {
+        static_cast<T*>(items[i])->T::chop(out);
+    }
+}
+
+template <class T>
+void tasteRun(Food* const* items, size_t count, ostream& out) {
+    for (size_t i = 0; i < count; ++i) {
+        static_cast<T*>(items[i])->T::taste(out);
     }
+}
+
+const FoodRunFn kFoodOps[kKindCount][kOpCount] = {
+    { chopRun<Food>, tasteRun<Food> },
+    { chopRun<Fruit>, tasteRun<Fruit> },
 };
 
-int main() {
+// Обход пачки сериями: подряд идущие объекты одного типа уходят в одну функцию таблицы
+void dispatchRuns(Food* const* items, size_t count, FoodOp op, ostream& out) {
+    size_t begin = 0;
+    while (begin < count) {
+        FoodKind kind = items[begin]->getKind();
+        size_t end = begin + 1;
+        while (end < count && items[end]->getKind() == kind) {
+            ++end;
+        }
+        kFoodOps[kind][op](items + begin, end - begin, out);
+        begin = end;
+    }
+}
+
+// Группировка по типу сортировкой подсчетом за O(n), устойчиво: порядок внутри типа сохраняется.
+// После нее dispatchRuns делает по одному косвенному вызову на тип
+void sortByKind(vector<Food*>& items) {
+    size_t offsets[kKindCount + 1] = {};
+    for (const Food* food : items) {
+        ++offsets[food->getKind() + 1];
+    }
+    for (size_t k = 1; k <= kKindCount; ++k) {
+        offsets[k] += offsets[k - 1];
+    }
+    vector<Food*> grouped(items.size());
+    for (Food* food : items) {
+        grouped[offsets[food->getKind()]++] = food;
+    }
+    items.swap(grouped);
+}
+
+// Заказ на обработку одного продукта; проходит через все стадии конвейера
+struct KitchenTicket {
+    size_t sequence = 0;        // Номер во входной партии
+    Food* food = nullptr;
+    Fruit* fruit = nullptr;     // Не nullptr, если продукт - фрукт и его нужно очистить
+    ostringstream transcript;   // Вывод chop и taste - как у prepareAndTaste()
+    ostringstream peelLog;      // Вывод стадии очистки
+    uint64_t enqueuedNs = 0;    // Когда заказ встал в очередь текущей стадии
+};
+
+// Счетчики одной стадии конвейера
+struct StageStats {
+    atomic<uint64_t> items{0};        // Обработано заказов
+    atomic<uint64_t> batches{0};      // Обработано пачек
+    atomic<uint64_t> busyNs{0};       // Время работы над заказами (без ожидания)
+    atomic<uint64_t> latencyNs{0};    // Сумма времени от постановки в очередь до конца обработки
+    atomic<uint64_t> maxLatencyNs{0};
+    atomic<uint64_t> stalls{0};       // Неудачных попыток отдать заказ дальше (очередь полна)
+};
+
+// Конвейер chop -> peel (только Fruit) -> taste.
+// У каждой стадии свой пул потоков и ограниченная очередь на входе. Потоки забирают заказы
+// пачками, а если следующая очередь заполнена, ждут ее освобождения (обратное давление),
+// так что число заказов в работе не превышает суммарной емкости очередей.
+// Потоки создаются один раз вместе с конвейером и переживают вызовы run(); без работы
+// (пустая очередь, полная следующая очередь, нет партии) они спят на условной переменной.
+// Результат каждого заказа складывается в его собственный поток, поэтому порядок обработки
+// не влияет на текст, а итог выдается в порядке входной партии
+class FoodPipeline {
+
+public:
+
+    static const size_t kStages = 3;
+
+    struct Options {
+        size_t workersPerStage = 2;
+        size_t batchSize = 32;
+        size_t queueCapacity = 1024;
+    };
+
+private:
+
+    // Место сна потоков, ждущих изменения очереди
+    struct Parking {
+        mutex lock;
+        condition_variable wake;
+        atomic<size_t> sleepers{0};
+    };
+
+    Options options;
+    vector<unique_ptr<BoundedQueue<KitchenTicket*>>> queues;
+    StageStats stats[kStages];
+    atomic<bool> upstreamDone[kStages];
+    atomic<size_t> activeWorkers[kStages];
+    Parking itemsReady[kStages]; // Ждут заказов во входной очереди стадии
+    Parking spaceReady[kStages]; // Ждут места во входной очереди стадии
+    uint64_t wallNs = 0;
+    size_t lastBatch = 0;
+
+    // Запуск партий: поток берет новую партию, когда меняется generation
+    mutex control;
+    condition_variable started, finished;
+    uint64_t generation = 0;
+    size_t finishedWorkers = 0;
+    bool stopping = false;
+    vector<thread> threads;
+
+    // Ждет, пока ready() не вернет true. Спящий сначала объявляет о себе, потом перепроверяет
+    // условие, а будящий сначала меняет очередь, потом смотрит на число спящих - пробуждение не теряется
+    template <class Ready>
+    static void park(Parking& parking, Ready ready) {
+        unique_lock<mutex> lock(parking.lock);
+        parking.sleepers.fetch_add(1);
+        atomic_thread_fence(memory_order_seq_cst);
+        parking.wake.wait(lock, ready);
+        parking.sleepers.fetch_sub(1);
+    }
+
+    static void wakeOne(Parking& parking) {
+        atomic_thread_fence(memory_order_seq_cst);
+        if (parking.sleepers.load(memory_order_relaxed) > 0) {
+            lock_guard<mutex> lock(parking.lock);
+            parking.wake.notify_one();
+        }
+    }
+
+    static void wakeAll(Parking& parking) {
+        lock_guard<mutex> lock(parking.lock);
+        parking.wake.notify_all();
+    }
+
+    static void process(size_t stage, KitchenTicket& ticket) {
+        if (stage == 0) {
+            ticket.food->beginPrepare(ticket.transcript);
+        }
+        else if (stage == 1) {
+            if (ticket.fruit) {
+                ticket.fruit->peel(ticket.peelLog);
+            }
+        }
+        else {
+            ticket.food->finishPrepare(ticket.transcript);
+        }
+    }
+
+    // Отдает заказ в очередь, ожидая места в ней. Потребителей будит вызывающий - один раз
+    // на пачку; если очередь полна, они будятся здесь, до засыпания
+    void pushWithBackpressure(size_t stage, KitchenTicket* ticket, uint64_t& stalls) {
+        ticket->enqueuedNs = bench::nowNs();
+        if (!queues[stage]->tryPush(ticket)) {
+            ++stalls;
+            wakeOne(itemsReady[stage]);
+            park(spaceReady[stage], [&] { return queues[stage]->tryPush(ticket); });
+        }
+    }
+
+    // Последний поток стадии сообщает следующей, что новых заказов не будет
+    void finishStage(size_t stage) {
+        upstreamDone[stage].store(true, memory_order_release);
+        wakeAll(itemsReady[stage]);
+    }
+
+    // Обработка одной партии потоком стадии
+    void work(size_t stage, vector<KitchenTicket*>& batch) {
+        uint64_t items = 0, batches = 0, busy = 0, latency = 0, maxLatency = 0, stalls = 0;
+
+        for (;;) {
+            batch.clear();
+            KitchenTicket* ticket = nullptr;
+            while (batch.size() < options.batchSize && queues[stage]->tryPop(ticket)) {
+                batch.push_back(ticket);
+            }
+            if (batch.empty()) {
+                // Спит, пока не появится заказ или предыдущая стадия не закончит
+                bool popped = false;
+                park(itemsReady[stage], [&] {
+                    popped = queues[stage]->tryPop(ticket);
+                    return popped || upstreamDone[stage].load(memory_order_acquire);
+                });
+                // Предыдущая стадия закончила, и очередь пуста - работы больше не будет
+                if (!popped && !queues[stage]->tryPop(ticket)) {
+                    break;
+                }
+                batch.push_back(ticket);
+            }
+            wakeOne(spaceReady[stage]);
+
+            uint64_t begin = bench::nowNs();
+            for (KitchenTicket* t : batch) {
+                process(stage, *t);
+            }
+            uint64_t end = bench::nowNs();
+
+            busy += end - begin;
+            items += batch.size();
+            ++batches;
+            for (KitchenTicket* t : batch) {
+                latency += end - t->enqueuedNs;
+                maxLatency = max(maxLatency, end - t->enqueuedNs);
+            }
+            if (stage + 1 < kStages) {
+                for (KitchenTicket* t : batch) {
+                    pushWithBackpressure(stage + 1, t, stalls);
+                }
+                wakeOne(itemsReady[stage + 1]);
+            }
+        }
+
+        StageStats& s = stats[stage];
+        s.items += items;
+        s.batches += batches;
+        s.busyNs += busy;
+        s.latencyNs += latency;
+        s.stalls += stalls;
+        uint64_t seen = s.maxLatencyNs.load();
+        while (seen < maxLatency && !s.maxLatencyNs.compare_exchange_weak(seen, maxLatency)) {
+        }
+
+        if (activeWorkers[stage].fetch_sub(1) == 1 && stage + 1 < kStages) {
+            finishStage(stage + 1);
+        }
+    }
+
+    void worker(size_t stage) {
+        vector<KitchenTicket*> batch;
+        batch.reserve(options.batchSize);
+        uint64_t seen = 0;
+
+        for (;;) {
+            {
+                unique_lock<mutex> lock(control);
+                started.wait(lock, [&] { return stopping || generation != seen; });
+                if (stopping) {
+                    return;
+                }
+                seen = generation;
+            }
+
+            work(stage, batch);
+
+            {
+                lock_guard<mutex> lock(control);
+                ++finishedWorkers;
+            }
+            finished.notify_one();
+        }
+    }
+
+public:
+
+    explicit FoodPipeline(Options opts) : options(opts) {
+        options.workersPerStage = max<size_t>(options.workersPerStage, 1);
+        options.batchSize = max<size_t>(options.batchSize, 1);
+        for (size_t i = 0; i < kStages; ++i) {
+            queues.push_back(make_unique<BoundedQueue<KitchenTicket*>>(options.queueCapacity));
+        }
+        for (size_t stage = 0; stage < kStages; ++stage) {
+            for (size_t w = 0; w < options.workersPerStage; ++w) {
+                threads.emplace_back([this, stage] { worker(stage); });
+            }
+        }
+    }
+
+    ~FoodPipeline() {
+        {
+            lock_guard<mutex> lock(control);
+            stopping = true;
+        }
+        started.notify_all();
+        for (thread& t : threads) {
+            t.join();
+        }
+    }
+
+    FoodPipeline(const FoodPipeline&) = delete;
+    FoodPipeline& operator=(const FoodPipeline&) = delete;
+
+    // Обрабатывает партию; возвращает протоколы prepareAndTaste() в порядке партии.
+    // peelLogs (если передан) получает вывод стадии очистки
+    vector<string> run(const vector<Food*>& foods, vector<string>* peelLogs = nullptr) {
+        vector<KitchenTicket> tickets(foods.size());
+        for (size_t i = 0; i < foods.size(); ++i) {
+            tickets[i].sequence = i;
+            tickets[i].food = foods[i];
+            tickets[i].fruit = dynamic_cast<Fruit*>(foods[i]);
+        }
+
+        for (size_t i = 0; i < kStages; ++i) {
+            upstreamDone[i].store(false);
+            activeWorkers[i].store(options.workersPerStage);
+            stats[i].items = 0;
+            stats[i].batches = 0;
+            stats[i].busyNs = 0;
+            stats[i].latencyNs = 0;
+            stats[i].maxLatencyNs = 0;
+            stats[i].stalls = 0;
+        }
+
+        bench::Stopwatch timer;
+        {
+            lock_guard<mutex> lock(control);
+            ++generation;
+            finishedWorkers = 0;
+        }
+        started.notify_all();
+
+        uint64_t feederStalls = 0;
+        for (size_t i = 0; i < tickets.size(); ++i) {
+            pushWithBackpressure(0, &tickets[i], feederStalls);
+            if (i % options.batchSize == options.batchSize - 1) {
+                wakeOne(itemsReady[0]);
+            }
+        }
+        finishStage(0);
+
+        {
+            unique_lock<mutex> lock(control);
+            finished.wait(lock, [&] { return finishedWorkers == threads.size(); });
+        }
+        wallNs = timer.elapsedNs();
+        lastBatch = foods.size();
+
+        // Заказы лежат в массиве по номеру, так что восстанавливать порядок не нужно
+        vector<string> results(tickets.size());
+        if (peelLogs) {
+            peelLogs->assign(tickets.size(), string());
+        }
+        for (KitchenTicket& ticket : tickets) {
+            results[ticket.sequence] = ticket.transcript.str();
+            if (peelLogs) {
+                (*peelLogs)[ticket.sequence] = ticket.peelLog.str();
+            }
+        }
+
+        return results;
+    }
+
+    void printStats(ostream& out) const {
+        const char* names[kStages] = { "chop", "peel", "taste" };
+        out << "Конвейер: " << lastBatch << " продуктов за " << wallNs / 1000000 << " мс ("
+            << (wallNs ? lastBatch * 1000000000.0 / wallNs : 0) << " шт/с), потоков на стадию: "
+            << options.workersPerStage << ", пачка: " << options.batchSize << endl;
+        for (size_t i = 0; i < kStages; ++i) {
+            const StageStats& s = stats[i];
+            uint64_t items = s.items.load();
+            uint64_t busy = s.busyNs.load();
+            out << "  " << names[i] << ": " << items << " шт, " << s.batches.load() << " пачек, "
+                << (busy ? items * 1000000000.0 / busy : 0) << " шт/с на поток, задержка ср. "
+                << (items ? s.latencyNs.load() / items / 1000.0 : 0) << " мкс, макс. "
+                << s.maxLatencyNs.load() / 1000.0 << " мкс, ожиданий очереди: " << s.stalls.load() << endl;
+        }
+    }
+};
+
+// Замер: конвейер против последовательного prepareAndTaste() с проверкой совпадения результатов
+int benchmarkPipeline(int argc, char* argv[]) {
+
+    lifecycle::ScopedMute mute;
+
+    size_t n = 200000;
+    FoodPipeline::Options options;
+    if (!bench::countArg(argc, argv, 2, n) || !bench::countArg(argc, argv, 3, options.workersPerStage)
+        || !bench::countArg(argc, argv, 4, options.batchSize)) {
+        return 1;
+    }
+
+    // Две одинаковые перемешанные партии: для конвейера и для эталона
+    vector<unique_ptr<Food>> batch, reference;
+    uint64_t seed = 2024;
+    for (size_t i = 0; i < n; ++i) {
+        seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+        bool fruit = (seed >> 33) % 3 != 0;
+        if (fruit) {
+            batch.push_back(names::makeNamed<Fruit>("Фрукт #", i));
+            reference.push_back(names::makeNamed<Fruit>("Фрукт #", i));
+        }
+        else {
+            batch.push_back(names::makeNamed<Food>("Еда #", i));
+            reference.push_back(names::makeNamed<Food>("Еда #", i));
+        }
+    }
+
+    bench::Stopwatch timer;
+    vector<string> expected(n), expectedPeel(n);
+    for (size_t i = 0; i < n; ++i) {
+        ostringstream out, peelOut;
+        reference[i]->prepareAndTaste(out);
+        if (Fruit* fruit = dynamic_cast<Fruit*>(reference[i].get())) {
+            fruit->peel(peelOut);
+        }
+        expected[i] = out.str();
+        expectedPeel[i] = peelOut.str();
+    }
+    uint64_t sequentialNs = timer.elapsedNs();
+
+    vector<Food*> items;
+    for (auto& food : batch) {
+        items.push_back(food.get());
+    }
+
+    FoodPipeline pipeline(options);
+    vector<string> peelLogs;
+    vector<string> results = pipeline.run(items, &peelLogs);
+
+    bool same = results == expected && peelLogs == expectedPeel;
+    for (size_t i = 0; i < n && same; ++i) {
+        Fruit* fruit = dynamic_cast<Fruit*>(batch[i].get());
+        same = !fruit || fruit->peeled;
+    }
+
+    cout << "Последовательно: " << sequentialNs / 1000000 << " мс" << endl;
+    pipeline.printStats(cout);
+    cout << "Результаты " << (same ? "совпадают" : "НЕ СОВПАДАЮТ") << " с последовательным prepareAndTaste()" << endl;
+
+    return same ? 0 : 1;
+}
+
+// Замер: chop/taste по перемешанной пачке через виртуальные вызовы, через таблицу сериями
+// и через таблицу после группировки по типу; с числом промахов предсказания переходов
+int benchmarkDispatch(int argc, char* argv[]) {
+
+    lifecycle::ScopedMute mute;
+
+    size_t n = 1000000;
+    if (!bench::countArg(argc, argv, 3, n)) {
+        return 1;
+    }
+
+    vector<unique_ptr<Food>> owned;
+    owned.reserve(n);
+    uint64_t seed = 77;
+    for (size_t i = 0; i < n; ++i) {
+        seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+        if ((seed >> 33) % 2) {
+            owned.push_back(make_unique<Fruit>("Яблоко"));
+        }
+        else {
+            owned.push_back(make_unique<Food>("Хлеб"));
+        }
+    }
+    vector<Food*> shuffled;
+    for (const auto& food : owned) {
+        shuffled.push_back(food.get());
+    }
+    vector<Food*> grouped = shuffled;
+    bench::Stopwatch sortTimer;
+    sortByKind(grouped);
+    uint64_t sortNs = sortTimer.elapsedNs();
+
+    // Эталон: chop точного типа через dynamic_cast (сам chop не виртуальный), taste - виртуальный вызов
+    auto virtualPath = [](const vector<Food*>& items, FoodOp op, ostream& out) {
+        for (Food* food : items) {
+            if (op == kOpTaste) {
+                food->taste(out);
+            }
+            else if (Fruit* fruit = dynamic_cast<Fruit*>(food)) {
+                fruit->chop(out);
+            }
+            else {
+                food->chop(out);
+            }
+        }
+    };
+
+    // Проверка вывода на начале пачки
+    bool same = true;
+    {
+        size_t m = min<size_t>(n, 2000);
+        vector<Food*> head(shuffled.begin(), shuffled.begin() + m);
+        vector<Food*> headGrouped = head;
+        sortByKind(headGrouped);
+        for (FoodOp op : { kOpChop, kOpTaste }) {
+            ostringstream expected, runs, expectedGrouped, groupedRuns;
+            virtualPath(head, op, expected);
+            dispatchRuns(head.data(), head.size(), op, runs);
+            virtualPath(headGrouped, op, expectedGrouped);
+            dispatchRuns(headGrouped.data(), headGrouped.size(), op, groupedRuns);
+            same = same && expected.str() == runs.str() && expectedGrouped.str() == groupedRuns.str();
+        }
+    }
+
+    bench::NullBuffer nullBuffer;
+    ostream sink(&nullBuffer);
+    bench::PerfCounter misses = bench::PerfCounter::branchMisses();
+
+    auto measure = [&](const char* label, auto&& run) {
+        bench::Stopwatch timer;
+        misses.start();
+        run(kOpChop);
+        run(kOpTaste);
+        uint64_t missCount = misses.stop();
+        cout << "  " << label << ": " << static_cast<double>(timer.elapsedNs()) / (2.0 * n) << " нс/вызов, промахов предсказания: ";
+        if (misses.available()) {
+            cout << static_cast<double>(missCount) / (2.0 * n) << " на вызов" << endl;
+        }
+        else {
+            cout << "счетчик недоступен" << endl;
+        }
+    };
+
+    cout << "Пачка Food/Fruit вперемешку: " << n << " объектов, chop и taste" << endl;
+    measure("виртуальные вызовы", [&](FoodOp op) { virtualPath(shuffled, op, sink); });
+    measure("таблица, серии", [&](FoodOp op) { dispatchRuns(shuffled.data(), shuffled.size(), op, sink); });
+    measure("таблица после группировки", [&](FoodOp op) { dispatchRuns(grouped.data(), grouped.size(), op, sink); });
+    cout << "  группировка по типу: " << sortNs / 1000000.0 << " мс (один раз на пачку)" << endl;
+    cout << "Результаты " << (same ? "совпадают" : "НЕ СОВПАДАЮТ") << " с виртуальными вызовами" << endl;
+
+    return same ? 0 : 1;
+}
+
+// Запуск замеров: Program1 bench [N] [workers] [batch] - конвейер, Program1 bench dispatch [N] - таблица операций
+int runBenchmark(int argc, char* argv[]) {
+
+    if (argc > 2 && string(argv[2]) == "dispatch") {
+        return benchmarkDispatch(argc, argv);
+    }
+
+    return benchmarkPipeline(argc, argv);
+}
+
+int main(int argc, char* argv[]) {
 
     setlocale(LC_ALL, "RU");
 
+    if (argc > 1 && string(argv[1]) == "bench") {
+        return runBenchmark(argc, argv);
+    }
+
     cout << "Создаем объект Fruit напрямую" << endl; 
     Fruit apple("Яблоко"); // Сначала Food("Яблоко"), потом Fruit("Яблоко")
 
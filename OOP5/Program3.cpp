@@ -2,6 +2,21 @@
 #include <string>
 #include <stdexcept> // Для bad_cast
 #include <clocale>   // Для setlocale
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <sstream>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "../Common/AllocHooks.h"
+#include "../Common/Bench.h"
+#include "../Common/LifecycleTrace.h"
+#include "../Common/NameBuilder.h"
+#include "../Common/PerfRegions.h"
 
 using namespace std;
 
@@ -13,33 +28,50 @@ protected:
     string id;
 
 public:
-    // Конструктор по умолчанию: присваивание id в теле
-    Food(string name = "Еда") {
-        this->id = name;
-        cout << "Конструктор Food поумолчанию: [" << id << "]" << endl;
+    ALLOC_PROFILE_TYPE("Food") // Учет живых объектов при сборке с -DALLOC_PROFILE=1
+
+    // Конструктор по умолчанию: имя принимается по значению и перемещается в поле
+    Food(string name = "Еда") : id(move(name)) {
+        LIFECYCLE_TRACE("Конструктор Food поумолчанию: [" << id << "]");
     }
 
+    // Имя из string_view
+    explicit Food(string_view name) : Food(string(name)) {}
+
+    // Имя из литерала, буфера char или const char*: строка до первого нуля.
+    // nullptr исключен, чтобы Food(nullptr) по-прежнему выбирал Food(Food*)
+    template <class T, enable_if_t<names::isCString<T>, int> = 0>
+    Food(const T& name) : Food(string(name)) {}
+
     // Конструктор копирования (стандартный): присваивание id в теле
     Food(const Food& other) {
         this->id = other.id + "_копия"; // Добавим суффикс для ясности
-        cout << "Конструктор Food копирования: с [" << other.id << "] на [" << id << "]" << endl;
+        LIFECYCLE_TRACE("Конструктор Food копирования: с [" << other.id << "] на [" << id << "]");
     }
 
+    // Конструктор перемещения: забирает id без копирования строки
+    Food(Food&& other) noexcept {
+        this->id = move(other.id);
+        LIFECYCLE_TRACE("Конструктор Food перемещения: [" << id << "]");
+    }
+
+    Food& operator=(const Food&) = default;
+
     // Конструктор из указателя
     Food(Food* obj) {
         if (obj) {
             this->id = obj->id + "_из_указателя"; // Добавим суффикс
-            cout << "Конструктор Food (из указателя *): с [" << obj->id << "] на [" << id << "]" << endl;
+            LIFECYCLE_TRACE("Конструктор Food (из указателя *): с [" << obj->id << "] на [" << id << "]");
         }
         else {
             this->id = "Еда_из_null_указателя";
-            cout << "Конструктор Food (из указателя *): Получен nullptr, создан [" << id << "]" << endl;
+            LIFECYCLE_TRACE("Конструктор Food (из указателя *): Получен nullptr, создан [" << id << "]");
         }
     }
 
     // Деструктор
     virtual ~Food() {
-        cout << "Деструктор Food: [" << id << "]" << endl;
+        LIFECYCLE_TRACE("Деструктор Food: [" << id << "]");
     }
 
     // Виртуальный метод
@@ -54,32 +86,46 @@ public:
 //  Класс-потомок: Напиток 
 class Drink : public Food {
 public:
+    ALLOC_PROFILE_TYPE("Drink")
+
     // Конструктор по умолчанию: БАЗОВЫЙ КЛАСС инициализируется в списке
-    Drink(string name = "Напиток") : Food(name) {
-        cout << "Конструктор Drink поумолчанию: [" << id << "]" << endl;
+    Drink(string name = "Напиток") : Food(move(name)) {
+        LIFECYCLE_TRACE("Конструктор Drink поумолчанию: [" << id << "]");
     }
 
+    explicit Drink(string_view name) : Drink(string(name)) {}
+
+    template <class T, enable_if_t<names::isCString<T>, int> = 0>
+    Drink(const T& name) : Drink(string(name)) {}
+
     // Конструктор копирования (стандартный): БАЗОВЫЙ КЛАСС инициализируется в списке
     Drink(const Drink& other) : Food(other) { // Вызывает Food(const Food&)
-        cout << "Конструктор Drink копирования: с [" << other.id << "] на [" << id << "]" << endl;
+        LIFECYCLE_TRACE("Конструктор Drink копирования: с [" << other.id << "] на [" << id << "]");
+    }
+
+    // Конструктор перемещения
+    Drink(Drink&& other) noexcept : Food(move(other)) {
+        LIFECYCLE_TRACE("Конструктор Drink перемещения: [" << id << "]");
     }
 
+    Drink& operator=(const Drink&) = default;
+
     // Конструктор из указателя
     // Инициализируем базовую часть Food, используя конструктор Food(Food*)
     Drink(Drink* obj) : Food(obj) { // Вызывает Food(Food*), т.к. Drink* -> Food*
         // id уже инициализирован базовым конструктором Food(Food*)
         if (obj) {
-            cout << "Конструктор Drink (из указателя *): с [" << obj->id << "] (базовый установил [" << id << "])" << endl;
+            LIFECYCLE_TRACE("Конструктор Drink (из указателя *): с [" << obj->id << "] (базовый установил [" << id << "])");
         }
         else {
-            cout << "Конструктор Drink (из указателя *): Получен nullptr (базовый установил [" << id << "])" << endl;
+            LIFECYCLE_TRACE("Конструктор Drink (из указателя *): Получен nullptr (базовый установил [" << id << "])");
         }
     }
 
 
     // Деструктор
     ~Drink() override {
-        cout << "Деструктор Drink: [" << id << "]" << endl;
+        LIFECYCLE_TRACE("Деструктор Drink: [" << id << "]");
     }
 
     // Переопределение виртуального метода
@@ -101,7 +147,7 @@ void func1_value(Food food_copy) {
     cout << "Параметр food_copy: id=" << food_copy.getID() << endl;
     food_copy.eat(); // Вызовется Food::eat из-за срезки
 
-    Drink* d_ptr = dynamic_cast<Drink*>(&food_copy);
+    Drink* d_ptr = PERF_REGION_EXPR("Program3/func1_value dynamic_cast", dynamic_cast<Drink*>(&food_copy));
     if (!d_ptr) {
         cout << "Невозможно привести копию к Drink* внутри func1_value (произошла срезка)" << endl;
     }
@@ -120,7 +166,7 @@ void func2_pointer(Food* food_ptr) {
     cout << " Параметр food_ptr указывает на: id=" << food_ptr->getID() << endl;
     food_ptr->eat(); // Полиморфный вызов
 
-    Drink* d_ptr = dynamic_cast<Drink*>(food_ptr);
+    Drink* d_ptr = PERF_REGION_EXPR("Program3/func2_pointer dynamic_cast", dynamic_cast<Drink*>(food_ptr));
     if (d_ptr) {
         cout << "dynamic_cast к Drink* успешен внутри func2_pointer" << endl;
         d_ptr->pour();
@@ -138,7 +184,7 @@ void func3_reference(Food& food_ref) {
     food_ref.eat(); // Полиморфный вызов
 
     try {
-        Drink& d_ref = dynamic_cast<Drink&>(food_ref);
+        Drink& d_ref = PERF_REGION_EXPR("Program3/func3_reference dynamic_cast", dynamic_cast<Drink&>(food_ref));
         cout << "dynamic_cast<Drink&> успешен внутри func3_reference" << endl;
         d_ref.pour();
     }
@@ -148,11 +194,362 @@ void func3_reference(Food& food_ref) {
     cout << " Выход из func3_reference(Food& food_ref) " << endl;
 }
 
+//  Значение с сохранением динамического типа 
+
+// Обработчики для конкретного типа, хранимого в FoodValue (таблица вместо виртуальных функций)
+struct FoodValueOps {
+    bool inlineStorage;                            // Объект лежит во встроенном буфере, иначе в куче
+    void (*eat)(const void* object);
+    void* (*copyTo)(const void* object, void* storage); // Создает копию в storage, возвращает объект
+    void (*moveTo)(void* object, void* storage) noexcept; // Только для встроенного хранения
+    void (*destroy)(void* object) noexcept;
+    Food* (*asFood)(void* object);
+};
 
-int main() {
+// Food или потомок, переданный по значению без срезки.
+// Объекты, помещающиеся в kInlineSize байт, хранятся прямо внутри FoodValue без выделения
+// памяти; большие - в куче. eat() вызывается через таблицу обработчиков квалифицированным
+// вызовом T::eat(), без виртуальной диспетчеризации. Перемещение встроенного объекта -
+// его конструктор перемещения, объекта в куче - передача указателя
+class FoodValue {
+
+public:
+
+    static constexpr size_t kInlineSize = 64;
+
+private:
+
+    alignas(max_align_t) unsigned char storage[kInlineSize];
+    const FoodValueOps* ops = nullptr;
+
+    template <class T>
+    static constexpr bool fitsInline = sizeof(T) <= kInlineSize && alignof(T) <= alignof(max_align_t)
+        && is_nothrow_move_constructible<T>::value;
+
+    template <class T>
+    static const FoodValueOps* opsFor() {
+        static const FoodValueOps ops = {
+            fitsInline<T>,
+            [](const void* object) { static_cast<const T*>(object)->T::eat(); },
+            [](const void* object, void* place) -> void* {
+                const T& source = *static_cast<const T*>(object);
+                if constexpr (fitsInline<T>) {
+                    return new (place) T(source);
+                }
+                else {
+                    T* copy = new T(source);
+                    *static_cast<void**>(place) = copy;
+                    return copy;
+                }
+            },
+            [](void* object, void* place) noexcept {
+                if constexpr (fitsInline<T>) {
+                    new (place) T(move(*static_cast<T*>(object)));
+                }
+                else {
+                    (void)object;
+                    (void)place;
+                }
+            },
+            [](void* object) noexcept {
+                if constexpr (fitsInline<T>) {
+                    static_cast<T*>(object)->~T();
+                }
+                else {
+                    delete static_cast<T*>(object);
+                }
+            },
+            [](void* object) -> Food* { return static_cast<T*>(object); }
+        };
+        return &ops;
+    }
+
+    void* object() {
+        return ops->inlineStorage ? static_cast<void*>(storage) : *reinterpret_cast<void**>(storage);
+    }
+
+    const void* object() const {
+        return ops->inlineStorage ? static_cast<const void*>(storage) : *reinterpret_cast<void* const*>(storage);
+    }
+
+    void reset() noexcept {
+        if (ops) {
+            ops->destroy(object());
+            ops = nullptr;
+        }
+    }
+
+    void moveFrom(FoodValue& other) noexcept {
+        if (!other.ops) {
+            return;
+        }
+        if (other.ops->inlineStorage) {
+            other.ops->moveTo(other.storage, storage);
+            other.ops->destroy(other.storage);
+        }
+        else {
+            *reinterpret_cast<void**>(storage) = *reinterpret_cast<void**>(other.storage);
+        }
+        ops = other.ops;
+        other.ops = nullptr;
+    }
+
+public:
+
+    FoodValue() = default;
+
+    // Из объекта Food или его потомка: копирование или перемещение в точном типе
+    template <class T, class = enable_if_t<is_base_of<Food, decay_t<T>>::value && !is_same<decay_t<T>, FoodValue>::value>>
+    FoodValue(T&& food) {
+        emplace<decay_t<T>>(forward<T>(food));
+    }
+
+    FoodValue(const FoodValue& other) {
+        if (other.ops) {
+            other.ops->copyTo(other.object(), storage);
+            ops = other.ops;
+        }
+    }
+
+    FoodValue(FoodValue&& other) noexcept {
+        moveFrom(other);
+    }
+
+    FoodValue& operator=(const FoodValue& other) {
+        if (this != &other) {
+            FoodValue copy(other);
+            reset();
+            moveFrom(copy);
+        }
+        return *this;
+    }
+
+    FoodValue& operator=(FoodValue&& other) noexcept {
+        if (this != &other) {
+            reset();
+            moveFrom(other);
+        }
+        return *this;
+    }
+
+    ~FoodValue() {
+        reset();
+    }
+
+    // Создает объект типа T на месте
+    template <class T, class... Args>
+    T& emplace(Args&&... args) {
+        static_assert(is_base_of<Food, T>::value, "FoodValue хранит только Food и его потомков");
+        reset();
+        T* created;
+        if constexpr (fitsInline<T>) {
+            created = new (storage) T(forward<Args>(args)...);
+        }
+        else {
+            created = new T(forward<Args>(args)...);
+            *reinterpret_cast<void**>(storage) = created;
+        }
+        ops = opsFor<T>();
+        return *created;
+    }
+
+    explicit operator bool() const { return ops != nullptr; }
+
+    // Объект хранится во встроенном буфере (без кучи)
+    bool isInline() const { return ops && ops->inlineStorage; }
+
+    // Вызов eat() точного типа без виртуального вызова
+    void eat() const {
+        if (!ops) {
+            throw logic_error("FoodValue: пустое значение");
+        }
+        ops->eat(object());
+    }
+
+    Food* get() { return ops ? ops->asFood(object()) : nullptr; }
+
+    const Food* get() const { return ops ? ops->asFood(const_cast<void*>(object())) : nullptr; }
+
+    // Объект, если его точный тип - T (аналог dynamic_cast без RTTI для точного совпадения;
+    // для потомков T используйте dynamic_cast<T*>(get()))
+    template <class T>
+    T* target() { return ops == opsFor<T>() ? static_cast<T*>(object()) : nullptr; }
+
+    template <class T>
+    const T* target() const { return ops == opsFor<T>() ? static_cast<const T*>(object()) : nullptr; }
+};
+
+// Потомок Drink, не помещающийся во встроенный буфер FoodValue (для самопроверки)
+class BigDrink : public Drink {
+public:
+    ALLOC_PROFILE_TYPE("BigDrink")
+
+    char recipe[256] = {};
+
+    BigDrink(string name = "Большой напиток") : Drink(move(name)) {}
+
+    void eat() const override {
+        cout << "Выпиваем большой: [" << id << "]" << endl;
+    }
+};
+
+// Самопроверка FoodValue: Program3 check. Возвращает число ошибок
+int runSelfCheck() {
+
+    lifecycle::ScopedMute mute;
+    int failures = 0;
+    auto expect = [&failures](bool condition, const char* what) {
+        cout << (condition ? "  ok    " : "  FAIL  ") << what << endl;
+        failures += condition ? 0 : 1;
+    };
+
+    // Вывод eat() перехватываем, чтобы проверить, какая версия вызвана
+    auto eaten = [](const FoodValue& value) {
+        ostringstream captured;
+        streambuf* saved = cout.rdbuf(captured.rdbuf());
+        value.eat();
+        cout.rdbuf(saved);
+        return captured.str();
+    };
+
+    cout << "Самопроверка FoodValue" << endl;
+
+    Drink water("Вода");
+    Food bread("Хлеб");
+
+    // Восстановление Drink после передачи по значению
+    bool recovered = false;
+    string eatenInside;
+    auto byValue = [&](FoodValue value) {
+        Drink* drink = value.target<Drink>();
+        recovered = drink != nullptr && drink->getID() == "Вода_копия";
+        eatenInside = eaten(value);
+    };
+    byValue(water);
+    expect(recovered, "Drink, переданный по значению, восстанавливается через target<Drink>()");
+    expect(eatenInside.find("Выпиваем") == 0, "eat() вызывает Drink::eat, а не Food::eat");
+
+    byValue(bread);
+    expect(!recovered, "Food, переданный по значению, не приводится к Drink");
+
+    FoodValue drink(Drink("Сок"));
+    expect(drink.isInline(), "Drink хранится во встроенном буфере");
+    expect(drink.target<Food>() == nullptr && dynamic_cast<Drink*>(drink.get()) != nullptr, "target<T>() проверяет точный тип, dynamic_cast через get() работает");
+
+    {
+        alloc_hooks::AllocScope allocations;
+        FoodValue moved(move(drink));
+        FoodValue assigned;
+        assigned = move(moved);
+        expect(allocations.delta().allocations == 0, "перемещение встроенного значения не выделяет память");
+        expect(!drink && !moved && assigned.target<Drink>() && assigned.get()->getID() == "Сок", "после перемещения тип и данные сохраняются, источник пуст");
+    }
+
+    FoodValue big(BigDrink("Бочка"));
+    FoodValue bigCopy(big);
+    FoodValue bigMoved(move(big));
+    expect(!bigCopy.isInline() && bigCopy.target<BigDrink>() != nullptr, "большой объект хранится в куче и копируется в точном типе");
+    expect(eaten(bigMoved).find("Выпиваем большой") == 0 && !big, "перемещение объекта из кучи передает указатель");
+
+    // Выделения памяти при создании из разных видов имени (короткое имя помещается во встроенный буфер строки)
+    auto allocationsFor = [](auto&& make) {
+        alloc_hooks::AllocScope allocations;
+        make();
+        return allocations.delta().allocations;
+    };
+    const string longName = "Апельсиновый сок свежевыжатый";
+    string rvalueName = longName;
+    string rvalueDrinkName = longName;
+    string_view longView = longName;
+    expect(allocationsFor([] { Food f("Сок"); }) == 0, "короткий литерал: без выделений");
+    expect(allocationsFor([] { Food f("Апельсиновый сок свежевыжатый"); }) == 1, "длинный литерал: одно выделение");
+    expect(allocationsFor([&] { Food f(longView); }) == 1, "string_view: одно выделение");
+    expect(allocationsFor([&] { Food f(longName); }) == 1, "lvalue-строка: одна копия");
+    expect(allocationsFor([&] { Food f(move(rvalueName)); }) == 0, "rvalue-строка: перемещается без выделений");
+    expect(allocationsFor([&] { Drink d(move(rvalueDrinkName)); }) == 0 && allocationsFor([] { Drink d("Апельсиновый сок свежевыжатый"); }) == 1,
+        "Drink передает имя в Food без копии");
+    expect(allocationsFor([] { Food f(names::concat("Сок #", 7)); }) == 0 && allocationsFor([] { Food f(names::concat("Апельсиновый сок #", 12345)); }) == 1,
+        "имя из частей собирается одним выделением");
+
+    // Имя из указателя и из буфера char: строка до первого нуля
+    static_assert(is_constructible<Food, const char*>::value && is_constructible<Drink, char*>::value, "имя из const char* и char*");
+    const char* pointerName = "Груша";
+    char buffer[32] = "Яблоко";
+    Food fromPointer(pointerName);
+    Food fromBuffer(buffer);
+    unique_ptr<Food> drinkFromPointer = make_unique<Drink>(pointerName);
+    expect(fromPointer.getID() == "Груша" && drinkFromPointer->getID() == "Груша", "имя из const char*");
+    expect(fromBuffer.getID() == "Яблоко", "имя из буфера char без хвостовых нулей");
+
+    cout << (failures == 0 ? "Все проверки пройдены" : "Есть ошибки") << endl;
+
+    return failures;
+}
+
+// Замер: передача Drink в функцию по значению Food (срезка), через unique_ptr<Food> и через FoodValue
+void benchmarkFoodValue(size_t n) {
+
+    lifecycle::ScopedMute mute;
+
+    auto sliced = [](Food food) { food.eat(); };
+    auto boxed = [](unique_ptr<Food> food) { food->eat(); };
+    auto handle = [](FoodValue food) { food.eat(); };
+
+    struct Row {
+        const char* label;
+        uint64_t ns;
+        alloc_hooks::AllocStats allocations;
+    };
+    vector<Row> rows;
+
+    auto measure = [&](const char* label, auto&& call) {
+        alloc_hooks::AllocScope allocations;
+        bench::Stopwatch timer;
+        for (size_t i = 0; i < n; ++i) {
+            call();
+        }
+        rows.push_back({ label, timer.elapsedNs(), allocations.delta() });
+    };
+
+    {
+        bench::MuteStream quiet(cout); // eat() печатает в cout
+        measure("Food по значению (срезка)", [&] { sliced(Drink("Вода")); });
+        measure("unique_ptr<Food>", [&] { boxed(make_unique<Drink>("Вода")); });
+        measure("FoodValue", [&] { handle(FoodValue(Drink("Вода"))); });
+    }
+
+    cout << "Передача Drink по значению, вызовов: " << n << endl;
+    for (const Row& row : rows) {
+        cout << "  " << row.label << ": " << static_cast<double>(row.ns) / n << " нс/вызов, выделений на вызов: "
+            << static_cast<double>(row.allocations.allocations) / n << endl;
+    }
+}
+
+// Запуск замеров из командной строки: Program3 bench [количество вызовов]
+int runBenchmark(int argc, char* argv[]) {
+
+    size_t n = 1000000;
+    if (!bench::countArg(argc, argv, 2, n)) {
+        return 1;
+    }
+    benchmarkFoodValue(n);
+
+    return 0;
+}
+
+
+int main(int argc, char* argv[]) {
 
     setlocale(LC_ALL, "RU");
 
+    if (argc > 1 && string(argv[1]) == "check") {
+        return runSelfCheck() == 0 ? 0 : 1;
+    }
+
+    if (argc > 1 && string(argv[1]) == "bench") {
+        return runBenchmark(argc, argv);
+    }
+
     cout << "Создаем объекты" << endl;
 
     Food bread("Хлеб");
@@ -2,42 +2,249 @@
 #include <string>
 #include <utility> // для :move
 #include <clocale> // для setlocale
+#include <cstdint>
+#include <deque>
+#include <sstream>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+
+#include "../Common/AllocHooks.h"
+#include "../Common/Bench.h"
+#include "../Common/LifecycleTrace.h"
+#include "../Common/PerfRegions.h"
 
 using namespace std;
 
+// - Счетчики аудита Dish -
+// При сборке с -DDISH_AUDIT=1 каждый конструктор, присваивание и деструктор Dish, а также
+// сохранение новых базовых имен увеличивают счетчики ниже; режим "audit" сверяет их
+// с ожидаемыми для каждого makeDish_*. Без макроса счетчики не трогаются совсем
+#ifndef DISH_AUDIT
+#define DISH_AUDIT 0
+#endif
+
+struct DishAuditCounters {
+    uint64_t constructions = 0;   // Конструкторы из имени
+    uint64_t copies = 0;          // Конструкторы копирования
+    uint64_t moves = 0;           // Конструкторы перемещения
+    uint64_t copyAssignments = 0;
+    uint64_t moveAssignments = 0;
+    uint64_t destructions = 0;
+    uint64_t nameBytes = 0;       // Байт новых базовых имен в общей таблице
+
+    DishAuditCounters operator-(const DishAuditCounters& start) const {
+        DishAuditCounters d;
+        d.constructions = constructions - start.constructions;
+        d.copies = copies - start.copies;
+        d.moves = moves - start.moves;
+        d.copyAssignments = copyAssignments - start.copyAssignments;
+        d.moveAssignments = moveAssignments - start.moveAssignments;
+        d.destructions = destructions - start.destructions;
+        d.nameBytes = nameBytes - start.nameBytes;
+        return d;
+    }
+};
+
+inline DishAuditCounters dishAudit;
+
+#if DISH_AUDIT
+#define DISH_AUDIT_ADD(field, amount) (dishAudit.field += (amount))
+#else
+#define DISH_AUDIT_ADD(field, amount) ((void)0)
+#endif
+
+// - Компактное имя блюда -
+// Имя = цепочка префиксов + базовое имя + цепочка суффиксов, например
+// "Блюдо_перемещено_из_" + "Суп" + "_копия" + "_перемещено".
+// Базовые имена интернируются (каждое хранится один раз, таблица под мьютексом и растет
+// только с числом разных базовых имен), а метки копирования и перемещения лежат прямо
+// в объекте: до kMaxTokens с каждой стороны, дальше только считаются и выводятся как "+N".
+// Поэтому копирование, перемещение и присваивание имени не выделяют память и не трогают
+// общих данных, а строка собирается только при выводе
+class DishName {
+
+public:
+
+    enum Token : unsigned char {
+        kNone = 0,
+        kCopy,                  // "_копия"
+        kMoved,                 // "_перемещено"
+        kMoveAssigned,          // "_присвоено_перемещение"
+        kCopyAssigned,          // "_присвоено_копир"
+        kMovedFrom,             // Префикс "Блюдо_перемещено_из_"
+        kMoveAssignedFrom       // Префикс "Блюдо_присвоено_из_"
+    };
+
+    static constexpr size_t kMaxTokens = 8;
+
+private:
+
+    // Метки одной стороны в порядке добавления; не поместившиеся только считаются
+    struct TokenChain {
+
+        Token tokens[kMaxTokens] = {};
+        uint8_t count = 0;
+        uint32_t dropped = 0; // Насыщается на UINT32_MAX
+
+        void push(Token token) noexcept {
+            if (count < kMaxTokens) {
+                tokens[count++] = token;
+            }
+            else if (dropped != UINT32_MAX) {
+                ++dropped;
+            }
+        }
+
+        bool operator==(const TokenChain& other) const {
+            return count == other.count && dropped == other.dropped && equal(tokens, tokens + count, other.tokens);
+        }
+    };
+
+    struct Bases {
+        mutex lock;
+        deque<string> texts; // deque не перемещает строки, на них можно ссылаться
+        unordered_map<string_view, const string*> byText;
+    };
+
+    const string* base = &emptyBase(); // Интернированное базовое имя
+    TokenChain prefixes;
+    TokenChain suffixes;
+
+    static const string& emptyBase() {
+        static const string empty;
+        return empty;
+    }
+
+    static const char* tokenText(Token token) {
+        static const char* const texts[] = { "", "_копия", "_перемещено", "_присвоено_перемещение", "_присвоено_копир",
+            "Блюдо_перемещено_из_", "Блюдо_присвоено_из_" };
+        return texts[token];
+    }
+
+    static const string* intern(string_view text) {
+        if (text.empty()) {
+            return &emptyBase();
+        }
+        static Bases bases;
+        lock_guard<mutex> guard(bases.lock);
+        auto found = bases.byText.find(text);
+        if (found != bases.byText.end()) {
+            return found->second;
+        }
+        const string* stored = &bases.texts.emplace_back(text);
+        DISH_AUDIT_ADD(nameBytes, text.size());
+        bases.byText.emplace(*stored, stored);
+        return stored;
+    }
+
+public:
+
+    DishName() = default;
+
+    DishName(string_view text) : base(intern(text)) {}
+
+    DishName(const string& text) : base(intern(text)) {}
+
+    DishName(const char* text) : base(intern(text)) {}
+
+    // Имя с еще одним суффиксом справа
+    DishName withSuffix(Token token) const noexcept {
+        DishName result = *this;
+        result.suffixes.push(token);
+        return result;
+    }
+
+    // Имя с еще одним префиксом слева
+    DishName withPrefix(Token token) const noexcept {
+        DishName result = *this;
+        result.prefixes.push(token);
+        return result;
+    }
+
+    // Вывод без сборки строки; префиксы выводятся от последнего добавленного
+    void print(ostream& out) const {
+        if (prefixes.dropped != 0) {
+            out << "+" << prefixes.dropped;
+        }
+        for (size_t i = prefixes.count; i-- > 0;) {
+            out << tokenText(prefixes.tokens[i]);
+        }
+        out << *base;
+        for (size_t i = 0; i < suffixes.count; ++i) {
+            out << tokenText(suffixes.tokens[i]);
+        }
+        if (suffixes.dropped != 0) {
+            out << "+" << suffixes.dropped;
+        }
+    }
+
+    string str() const {
+        ostringstream out;
+        print(out);
+        return out.str();
+    }
+
+    bool operator==(const DishName& other) const {
+        return base == other.base && prefixes == other.prefixes && suffixes == other.suffixes;
+    }
+
+    bool operator!=(const DishName& other) const {
+        return !(*this == other);
+    }
+
+    friend ostream& operator<<(ostream& out, const DishName& name) {
+        name.print(out);
+        return out;
+    }
+};
+
 // - Класс для демонстрации: Блюдо -
 class Dish {
 
 public:
 
-    string name;
+    ALLOC_PROFILE_TYPE("Dish") // Учет живых объектов при сборке с -DALLOC_PROFILE=1
 
-    // Конструктор по умолчанию: Инициализация присваиванием
-    Dish(string n = "Безымянное блюдо") {
-        this->name = n;
-        cout << "Конструктор Dish: Приготовлено [" << name << "]" << endl; 
+    DishName name;
+
+    // Конструктор по умолчанию: имя сразу ищется в таблице базовых имен, строка не копируется
+    // (string, литералы и string_view приводятся к string_view)
+    Dish(string_view n = "Безымянное блюдо") : name(n) {
+        DISH_AUDIT_ADD(constructions, 1);
+        LIFECYCLE_TRACE("Конструктор Dish: Приготовлено [" << name << "]"); 
     }
 
     // Конструктор копирования: Инициализация присваиванием
     Dish(const Dish& other) {
-        this->name = other.name + "_копия";
-        cout << "КОНСТРУКТОР КОПИРОВАНИЯ Dish: с [" << other.name << "] на [" << name << "]" << endl; 
+        this->name = other.name.withSuffix(DishName::kCopy);
+        DISH_AUDIT_ADD(copies, 1);
+        LIFECYCLE_TRACE("КОНСТРУКТОР КОПИРОВАНИЯ Dish: с [" << other.name << "] на [" << name << "]"); 
     }
 
     // Конструктор перемещения: Инициализация присваиванием (через move)
     Dish(Dish&& other) noexcept {
-        // Используем присваивание вместо инициализации в списке
-        this->name = move(other.name) + "_перемещено";
-        other.name = "Блюдо_перемещено_из_" + this->name; // Используем this->name, т.к. оно уже содержит новое значение
-        cout << "КОНСТРУКТОР ПЕРЕМЕЩЕНИЯ Dish: с [" << other.name << "] на [" << name << "]" << endl; 
+        PERF_REGION("Program4/Dish move ctor");
+        // Используем присваивание вместо инициализации в списке; метки лежат в самом имени, память не выделяется
+        this->name = other.name.withSuffix(DishName::kMoved);
+        other.name = this->name.withPrefix(DishName::kMovedFrom); // Используем this->name, т.к. оно уже содержит новое значение
+        DISH_AUDIT_ADD(moves, 1);
+        LIFECYCLE_TRACE("КОНСТРУКТОР ПЕРЕМЕЩЕНИЯ Dish: с [" << other.name << "] на [" << name << "]"); 
     }
 
     // Оператор присваивания перемещением
     Dish& operator=(Dish&& other) noexcept {
+        PERF_REGION("Program4/Dish move assignment");
         if (this != &other) { // Проверка на самоприсваивание
-            this->name = move(other.name) + "_присвоено_перемещение";
-            other.name = "Блюдо_присвоено_из_" + this->name;
-            cout << "ОПЕРАТОР ПРИСВАИВАНИЯ ПЕРЕМЕЩЕНИЕМ Dish: с [" << other.name << "] на [" << name << "]" << endl; 
+            this->name = other.name.withSuffix(DishName::kMoveAssigned);
+            other.name = this->name.withPrefix(DishName::kMoveAssignedFrom);
+            DISH_AUDIT_ADD(moveAssignments, 1);
+            LIFECYCLE_TRACE("ОПЕРАТОР ПРИСВАИВАНИЯ ПЕРЕМЕЩЕНИЕМ Dish: с [" << other.name << "] на [" << name << "]"); 
         }
         return *this;
     }
@@ -45,8 +252,9 @@ public:
     // Оператор присваивания копированием
     Dish& operator=(const Dish& other) {
         if (this != &other) { // Проверка на самоприсваивание
-            this->name = other.name + "_присвоено_копир";
-            cout << "ОПЕРАТОР ПРИСВАИВАНИЯ КОПИРОВАНИЕМ Dish: с [" << other.name << "] на [" << name << "]" << endl; 
+            this->name = other.name.withSuffix(DishName::kCopyAssigned);
+            DISH_AUDIT_ADD(copyAssignments, 1);
+            LIFECYCLE_TRACE("ОПЕРАТОР ПРИСВАИВАНИЯ КОПИРОВАНИЕМ Dish: с [" << other.name << "] на [" << name << "]"); 
         }
         return *this;
     }
@@ -54,7 +262,8 @@ public:
 
     // Деструктор
     ~Dish() {
-        cout << "Деструктор Dish: Блюдо [" << name << "] съедено (уничтожено)" << endl; 
+        DISH_AUDIT_ADD(destructions, 1);
+        LIFECYCLE_TRACE("Деструктор Dish: Блюдо [" << name << "] съедено (уничтожено)"); 
     }
 
     // Метод serve
@@ -125,10 +334,500 @@ Dish& makeDish_dynamic_ref() {
     return *dynamic_dish; // Кто удалит? Неясно.
 }
 
-int main() {
+// === Фабрика блюд с проверкой владения ===
+
+class DishFactory;
+
+// Невладеющая ссылка на блюдо фабрики: номер ячейки и ее поколение.
+// После уничтожения блюда поколение ячейки меняется, и get() возвращает nullptr -
+// висячая ссылка обнаруживается за O(1), без санитайзеров
+struct DishRef {
+    DishFactory* factory = nullptr;
+    uint32_t index = 0;
+    uint32_t generation = 0;
+
+    Dish* get() const;
+
+    explicit operator bool() const { return get() != nullptr; }
+};
+
+// Владеющий дескриптор блюда: только перемещается, при уничтожении возвращает ячейку фабрике.
+// Обращение через пустой или устаревший дескриптор бросает logic_error
+class DishHandle {
+
+private:
+
+    DishRef ref;
+
+public:
+
+    DishHandle() = default;
+
+    explicit DishHandle(DishRef owned) : ref(owned) {}
+
+    DishHandle(const DishHandle&) = delete;
+    DishHandle& operator=(const DishHandle&) = delete;
+
+    DishHandle(DishHandle&& other) noexcept : ref(other.ref) {
+        other.ref = DishRef();
+    }
+
+    DishHandle& operator=(DishHandle&& other) noexcept {
+        if (this != &other) {
+            reset();
+            ref = other.ref;
+            other.ref = DishRef();
+        }
+        return *this;
+    }
+
+    ~DishHandle() {
+        reset();
+    }
+
+    void reset();
+
+    // Невладеющая ссылка на то же блюдо
+    DishRef weak() const { return ref; }
+
+    // Отказ от владения: блюдо остается жить и учитывается фабрикой как "без владельца",
+    // пока его не уничтожат через DishFactory::destroy
+    DishRef release();
+
+    Dish* get() const { return ref.get(); }
+
+    Dish& operator*() const;
+
+    Dish* operator->() const { return &**this; }
+};
+
+// Фабрика блюд: ячейки в кусках по kChunkSize (адреса не меняются), освобожденные ячейки
+// переиспользуются через список свободных. Каждая ячейка хранит поколение, которое
+// увеличивается при уничтожении блюда. Счетчики живых блюд, блюд без владельца и
+// обнаруженных обращений к уничтоженным доступны во время работы.
+// Фабрика должна жить дольше всех своих дескрипторов
+class DishFactory {
+
+public:
+
+    static const uint32_t kChunkSize = 1024;
+
+private:
+
+    struct Slot {
+        alignas(Dish) unsigned char storage[sizeof(Dish)];
+        uint32_t generation = 1;
+        uint32_t nextFree = 0;
+        bool live = false;
+        bool owned = false; // Есть владеющий DishHandle
+    };
+
+    vector<unique_ptr<Slot[]>> chunks;
+    uint32_t freeHead = UINT32_MAX;
+    uint32_t slotCount = 0;
+    size_t liveCount = 0;
+    size_t unownedCount = 0;
+    uint64_t staleCount = 0;
+    uint64_t misuseCount = 0;
+
+    Slot& slot(uint32_t index) {
+        return chunks[index / kChunkSize][index % kChunkSize];
+    }
+
+    Slot* find(uint32_t index, uint32_t generation) {
+        if (index >= slotCount) {
+            return nullptr;
+        }
+        Slot& s = slot(index);
+        return s.live && s.generation == generation ? &s : nullptr;
+    }
+
+    void destroySlot(uint32_t index, Slot& s) {
+        reinterpret_cast<Dish*>(s.storage)->~Dish();
+        s.live = false;
+        ++s.generation;
+        s.nextFree = freeHead;
+        freeHead = index;
+        --liveCount;
+    }
+
+    friend struct DishRef;
+    friend class DishHandle;
+
+public:
+
+    DishFactory() = default;
+
+    DishFactory(const DishFactory&) = delete;
+    DishFactory& operator=(const DishFactory&) = delete;
+
+    // Уничтожает оставшиеся блюда и сообщает о них как об утечке
+    ~DishFactory() {
+        size_t leaked = liveCount;
+        for (uint32_t i = 0; i < slotCount; ++i) {
+            Slot& s = slot(i);
+            if (s.live) {
+                destroySlot(i, s);
+            }
+        }
+        if (leaked > 0) {
+            cerr << "DishFactory: при уничтожении фабрики оставалось блюд: " << leaked << endl;
+        }
+    }
+
+    template <class... Args>
+    DishHandle make(Args&&... args) {
+        if (freeHead == UINT32_MAX) {
+            if (slotCount % kChunkSize == 0) {
+                chunks.emplace_back(new Slot[kChunkSize]);
+            }
+            slot(slotCount).nextFree = UINT32_MAX;
+            freeHead = slotCount++;
+        }
+
+        uint32_t index = freeHead;
+        Slot& s = slot(index);
+        new (s.storage) Dish(forward<Args>(args)...);
+        freeHead = s.nextFree;
+        s.live = true;
+        s.owned = true;
+        ++liveCount;
+
+        return DishHandle(DishRef{ this, index, s.generation });
+    }
+
+    // Уничтожение блюда без владельца (после DishHandle::release); false для устаревшей ссылки
+    // и для блюда, которым владеет DishHandle (такой вызов учитывается как ошибка использования)
+    bool destroy(const DishRef& ref) {
+        Slot* s = ref.factory == this ? find(ref.index, ref.generation) : nullptr;
+        if (!s) {
+            ++staleCount;
+            return false;
+        }
+        if (s->owned) {
+            ++misuseCount;
+            return false;
+        }
+        --unownedCount;
+        destroySlot(ref.index, *s);
+        return true;
+    }
+
+    size_t live() const { return liveCount; }
+
+    // Живые блюда без владельца: кандидаты в утечки
+    size_t unowned() const { return unownedCount; }
+
+    // Обнаруженные обращения к уже уничтоженным блюдам
+    uint64_t staleAccesses() const { return staleCount; }
+
+    // Отклоненные попытки уничтожить блюдо, у которого есть владелец
+    uint64_t misuses() const { return misuseCount; }
+
+    size_t capacity() const { return slotCount; }
+};
+
+inline Dish* DishRef::get() const {
+    if (!factory) {
+        return nullptr;
+    }
+    DishFactory::Slot* s = factory->find(index, generation);
+    return s ? reinterpret_cast<Dish*>(s->storage) : nullptr;
+}
+
+inline void DishHandle::reset() {
+    if (ref.factory) {
+        if (DishFactory::Slot* s = ref.factory->find(ref.index, ref.generation)) {
+            ref.factory->destroySlot(ref.index, *s);
+        }
+        ref = DishRef();
+    }
+}
+
+inline DishRef DishHandle::release() {
+    DishRef released = ref;
+    if (DishFactory::Slot* s = ref.factory ? ref.factory->find(ref.index, ref.generation) : nullptr) {
+        s->owned = false;
+        ++ref.factory->unownedCount;
+    }
+    ref = DishRef();
+    return released;
+}
+
+inline Dish& DishHandle::operator*() const {
+    Dish* dish = ref.get();
+    if (!dish) {
+        if (ref.factory) {
+            ++ref.factory->staleCount;
+        }
+        throw logic_error("DishHandle: обращение к уничтоженному или пустому блюду");
+    }
+    return *dish;
+}
+
+// Безопасные аналоги makeDish_*: блюдо всегда имеет владельца или учитывается как "без владельца"
+
+// 1, 4, 5. Возврат владеющего дескриптора вместо значения, копии с утечкой или сырого указателя
+DishHandle makeOwnedDish(DishFactory& factory, const char* name) {
+    DishHandle dish = factory.make(name);
+    dish->serve();
+    return dish;
+}
+
+// 2, 3. Бывшие висячие указатель и ссылка: невладеющая ссылка на блюдо, уничтоженное при
+// выходе из функции, - get() у нее вернет nullptr вместо неопределенного поведения
+DishRef makeDishRef_expired(DishFactory& factory, const char* name) {
+    DishHandle local_dish = factory.make(name);
+    local_dish->serve();
+    return local_dish.weak();
+}
+
+// 6. Блюдо без владельца: фабрика считает его, пока не вызван destroy
+DishRef makeDishRef_unowned(DishFactory& factory, const char* name) {
+    DishHandle dish = factory.make(name);
+    dish->serve();
+    return dish.release();
+}
+
+// Длительная проверка: каждый вариант фабрики вызывается iterations раз, RSS должен оставаться ровным
+int runSoak(int argc, char* argv[]) {
+
+    lifecycle::ScopedMute mute;
+
+    size_t iterations = 10000000;
+    if (!bench::countArg(argc, argv, 2, iterations)) {
+        return 1;
+    }
+    const size_t samples = 10;
+
+    DishFactory factory;
+    vector<size_t> rss;
+    size_t expiredDetected = 0;
+    size_t staleThrown = 0;
+    size_t ownedKept = 0;
+    bool countersOk = true;
+
+    bench::Stopwatch timer;
+    {
+        bench::MuteStream quiet(cout); // serve() печатает в cout
+        for (size_t i = 0; i < iterations; ++i) {
+            DishHandle soup = makeOwnedDish(factory, "Суп");
+            DishHandle fish = makeOwnedDish(factory, "Рыба_динам");
+            DishHandle roast = move(soup);
+            roast = makeOwnedDish(factory, "Жаркое_динам");
+
+            DishRef salad = makeDishRef_expired(factory, "Салат");
+            DishRef tea = makeDishRef_expired(factory, "Чай");
+            expiredDetected += (!salad ? 1 : 0) + (!tea ? 1 : 0);
+
+            DishRef dessert = makeDishRef_unowned(factory, "Десерт_динам");
+            countersOk = countersOk && factory.unowned() == 1 && factory.live() == 3;
+            countersOk = countersOk && factory.destroy(dessert);
+
+            // Блюдо с владельцем через destroy не уничтожается
+            ownedKept += !factory.destroy(fish.weak()) && fish.get() ? 1 : 0;
+
+            if (i % (iterations / samples + 1) == 0) {
+                rss.push_back(bench::currentRssKb());
+
+                // Обращение через устаревший дескриптор (исключение - только в точках замера, оно дорогое)
+                DishHandle stale(salad);
+                try {
+                    stale->serve();
+                }
+                catch (const logic_error&) {
+                    ++staleThrown;
+                }
+            }
+        }
+    }
+    uint64_t elapsedNs = timer.elapsedNs();
+    rss.push_back(bench::currentRssKb());
+
+    size_t minRss = *min_element(rss.begin(), rss.end());
+    size_t maxRss = *max_element(rss.begin(), rss.end());
+    bool flat = maxRss - minRss <= 1024; // Допуск 1 МБ на шум аллокатора и буферов
+    bool detected = expiredDetected == 2 * iterations && staleThrown == rss.size() - 1 && factory.staleAccesses() == staleThrown;
+    countersOk = countersOk && factory.live() == 0 && factory.unowned() == 0 && ownedKept == iterations && factory.misuses() == iterations;
+
+    cout << "Проверка DishFactory: " << iterations << " итераций по 6 вариантов, " << elapsedNs / 1000000 << " мс" << endl;
+    cout << "  RSS, КБ:";
+    for (size_t kb : rss) {
+        cout << " " << kb;
+    }
+    cout << endl;
+    cout << "  ячеек в фабрике: " << factory.capacity() << ", живых: " << factory.live() << ", без владельца: " << factory.unowned()
+        << ", висячих ссылок обнаружено: " << expiredDetected << endl;
+    cout << "  обращений через устаревший дескриптор: " << factory.staleAccesses() << ", отклонено уничтожений блюда с владельцем: "
+        << factory.misuses() << endl;
+    cout << "  RSS " << (flat ? "ровный" : "РАСТЕТ") << ", счетчики " << (countersOk && detected ? "верны" : "НЕВЕРНЫ") << endl;
+
+    return flat && detected && countersOk ? 0 : 1;
+}
+
+// Аудит путей возврата makeDish_*: Program4 audit (сборка с -DDISH_AUDIT=1).
+// Ожидания - по правилам C++17: NRVO для именованного локального объекта (GCC и Clang
+// выполняют его всегда, кроме -fno-elide-constructors). Если возврат, который раньше
+// обходился без копий, начнет копировать или перемещать, аудит завершится с ошибкой.
+// Байт имен во втором (установившемся) вызове должно быть 0: копии и перемещения не создают новых базовых имен
+int runAudit() {
+
+#if !DISH_AUDIT
+    cout << "Аудит недоступен: соберите программу с -DDISH_AUDIT=1" << endl;
+    return 2;
+#else
+    lifecycle::ScopedMute mute;
+
+    struct Expected {
+        uint64_t constructions, copies, moves, destructions;
+    };
+
+    struct Path {
+        const char* name;
+        Expected expected;
+        void (*call)();
+    };
+
+    // Каждый путь вызывается так же, как в main, включая удаление объектов, которые main удаляет.
+    // В пути 4 одно блюдо остается в куче - это и есть утечка makeDish_dynamic_val
+    const Path paths[] = {
+        { "1. makeDish_local_val", { 1, 0, 0, 1 }, [] { Dish result = makeDish_local_val(); } },
+        { "2. makeDish_local_ptr", { 1, 0, 0, 1 }, [] { (void)makeDish_local_ptr(); } },
+        { "3. makeDish_local_ref", { 1, 0, 0, 1 }, [] { (void)&makeDish_local_ref(); } },
+        { "4. makeDish_dynamic_val", { 1, 1, 0, 1 }, [] { Dish result = makeDish_dynamic_val(); } },
+        { "5. makeDish_dynamic_ptr", { 1, 0, 0, 1 }, [] { delete makeDish_dynamic_ptr(); } },
+        { "6. makeDish_dynamic_ref", { 1, 0, 0, 1 }, [] { delete &makeDish_dynamic_ref(); } },
+    };
+
+    int failures = 0;
+    cout << "Аудит Dish: конструкторы / копии / перемещения / деструкторы / байт имен" << endl;
+
+    for (const Path& path : paths) {
+        DishAuditCounters d;
+        {
+            bench::MuteStream quiet(cout); // Сами makeDish_* печатают в cout
+            path.call(); // Прогрев: базовые имена попадают в таблицу при первом вызове
+
+            DishAuditCounters start = dishAudit;
+            path.call();
+            d = dishAudit - start;
+        }
+
+        const Expected& e = path.expected;
+        bool ok = d.constructions == e.constructions && d.copies == e.copies && d.moves == e.moves
+            && d.copyAssignments == 0 && d.moveAssignments == 0 && d.destructions == e.destructions && d.nameBytes == 0;
+        failures += ok ? 0 : 1;
+
+        cout << (ok ? "  ok    " : "  FAIL  ") << path.name << ": " << d.constructions << " / " << d.copies << " / " << d.moves
+            << " / " << d.destructions << " / " << d.nameBytes;
+        if (!ok) {
+            cout << " (ожидалось " << e.constructions << " / " << e.copies << " / " << e.moves << " / " << e.destructions << " / 0, присваиваний "
+                << d.copyAssignments + d.moveAssignments << ")";
+        }
+        cout << endl;
+    }
+    cout << (failures == 0 ? "Аудит пройден" : "Аудит НЕ пройден") << endl;
+
+    return failures;
+#endif
+}
+
+// Замер: миллион "переходов" блюда (копирование, перемещение, присваивание перемещением)
+// с подсчетом выделений памяти; для сравнения - прежние имена-строки на коротком отрезке
+int runBenchmark(int argc, char* argv[]) {
+
+    lifecycle::ScopedMute mute;
+
+    size_t hops = 1000000;
+    if (!bench::countArg(argc, argv, 2, hops)) {
+        return 1;
+    }
+    size_t stringHops = min<size_t>(hops, 2000); // Строки растут на каждом шаге: дальше слишком долго
+
+    auto hop = [](Dish& current) {
+        Dish copy(current);
+        Dish moved(move(copy));
+        current = move(moved);
+    };
+
+    // Прежняя схема: те же операции над std::string со склейкой
+    const size_t fitHops = DishName::kMaxTokens / 3; // Каждый переход добавляет три суффикса
+    string fitted; // Имя после fitHops переходов: до этого места метки помещаются в DishName целиком
+    alloc_hooks::AllocScope stringAllocations;
+    bench::Stopwatch timer;
+    string reference = "Суп";
+    for (size_t i = 0; i < stringHops; ++i) {
+        string copy = reference + "_копия";
+        string moved = move(copy) + "_перемещено";
+        copy = "Блюдо_перемещено_из_" + moved;
+        reference = move(moved) + "_присвоено_перемещение";
+        moved = "Блюдо_присвоено_из_" + reference;
+        if (i + 1 == fitHops) {
+            fitted = reference;
+        }
+    }
+    uint64_t stringNs = timer.elapsedNs();
+    alloc_hooks::AllocStats stringDelta = stringAllocations.delta();
+
+    Dish dish("Суп");
+    alloc_hooks::AllocScope allocations;
+    timer.restart();
+    for (size_t i = 0; i < min(fitHops, hops); ++i) {
+        hop(dish);
+    }
+    DishName fittedName = dish.name; // Строку соберем после замера
+    for (size_t i = fitHops; i < hops; ++i) {
+        hop(dish);
+    }
+    uint64_t dishNs = timer.elapsedNs();
+    alloc_hooks::AllocStats dishDelta = allocations.delta();
+    bool same = hops < fitHops || fittedName.str() == fitted;
+
+    // Не поместившиеся метки только считаются: имя заканчивается на "+N"
+    uint64_t tokens = 3 * static_cast<uint64_t>(hops);
+    if (tokens > DishName::kMaxTokens) {
+        string tail = "+" + to_string(min<uint64_t>(tokens - DishName::kMaxTokens, UINT32_MAX));
+        string text = dish.name.str();
+        same = same && text.size() > tail.size() && text.compare(text.size() - tail.size(), tail.size(), tail) == 0;
+    }
+
+    // Имя зависит только от последовательности операций, а не от того, что было раньше
+    Dish again("Суп");
+    for (size_t i = 0; i < hops; ++i) {
+        hop(again);
+    }
+    same = same && again.name == dish.name;
+
+    cout << "Переходов Dish (копия + перемещение + присваивание перемещением): " << hops << endl;
+    cout << "  DishName (" << sizeof(DishName) << " байт, меток в объекте: " << DishName::kMaxTokens << " с каждой стороны): "
+        << static_cast<double>(dishNs) / hops << " нс/переход, выделений: " << dishDelta.allocations
+        << ", байт: " << dishDelta.bytes << endl;
+    cout << "  имя после всех переходов: " << dish.name << endl;
+    cout << "  std::string (" << stringHops << " переходов): " << static_cast<double>(stringNs) / stringHops
+        << " нс/переход, выделений на переход: " << static_cast<double>(stringDelta.allocations) / stringHops
+        << ", байт на переход: " << static_cast<double>(stringDelta.bytes) / stringHops
+        << ", длина имени: " << reference.size() << endl;
+    cout << "  имена " << (same ? "совпадают" : "НЕ СОВПАДАЮТ") << " с прежней склейкой строк" << endl;
+
+    return same ? 0 : 1;
+}
+
+int main(int argc, char* argv[]) {
     // Установка русской локали
     setlocale(LC_ALL, "RU");
 
+    if (argc > 1 && string(argv[1]) == "bench") {
+        return runBenchmark(argc, argv);
+    }
+
+    if (argc > 1 && string(argv[1]) == "soak") {
+        return runSoak(argc, argv);
+    }
+
+    if (argc > 1 && string(argv[1]) == "audit") {
+        return runAudit() == 0 ? 0 : 1;
+    }
+
     cout << endl << "Функция 1: Возврат по значению (локальный)" << endl; 
     Dish result1 = makeDish_local_val();
     cout << "  main: Получено блюдо result1 "; result1.serve();
@@ -4,26 +4,65 @@
 #include <vector>
 #include <utility> // для move
 #include <clocale> // для setlocale
+#include <atomic>
+#include <cstdint>
+#include <stdexcept>
+#include <thread>
+#include <mutex>
+#include <shared_mutex>
+#include <string_view>
+#include <unordered_map>
+#include <chrono>
+#include <algorithm>
+
+#include "../Common/AllocHooks.h"
+#include "../Common/Bench.h"
+#include "../Common/DeferredDestroy.h"
+#include "../Common/LifecycleTrace.h"
+#include "../Common/NameBuilder.h"
 
 using namespace std;
 
+// Счетчик ссылок внутри Ingredient для IngredientRef; при копировании объекта не копируется
+struct IngredientRefCount {
+    atomic<uint32_t> value{0};
+
+    IngredientRefCount() = default;
+
+    IngredientRefCount(const IngredientRefCount&) {}
+
+    IngredientRefCount& operator=(const IngredientRefCount&) { return *this; }
+};
+
 //  Класс для демонстрации: Ингредиент 
 class Ingredient {
 
 private:
 
     string name; // Поле класса
+    IngredientRefCount refCount; // Владельцы через IngredientRef
+
+    template <class CountPolicy>
+    friend class BasicIngredientRef;
 
 public:
-    // Конструктор: инициализация name через присваивание в теле
-    Ingredient(const string& n) {
-        this->name = n; // Присваивание вместо инициализации в списке
-        cout << "Ингредиент '" << name << "' получен (Конструктор)" << endl; 
+    ALLOC_PROFILE_TYPE("Ingredient") // Учет живых объектов при сборке с -DALLOC_PROFILE=1
+
+    // Конструктор: имя принимается по значению и перемещается в поле
+    Ingredient(string n) : name(move(n)) {
+        LIFECYCLE_TRACE("Ингредиент '" << name << "' получен (Конструктор)"); 
     }
 
+    // Имя из string_view
+    explicit Ingredient(string_view n) : Ingredient(string(n)) {}
+
+    // Имя из литерала, буфера char или const char*: строка до первого нуля (nullptr не подходит)
+    template <class T, enable_if_t<names::isCString<T>, int> = 0>
+    Ingredient(const T& n) : Ingredient(string(n)) {}
+
     // Деструктор
     ~Ingredient() {
-        cout << "Ингредиент '" << name << "' выброшен (Деструктор)" << endl; 
+        LIFECYCLE_TRACE("Ингредиент '" << name << "' выброшен (Деструктор)"); 
     }
 
     // Метод use
@@ -37,6 +76,434 @@ public:
     }
 };
 
+//  Интрузивный счетчик ссылок 
+
+// Способы изменения счетчика в объекте: обычный (атомарный) и однопоточный.
+// Однопоточный делает простые чтение и запись без блокирующих инструкций; пользоваться им
+// можно, только если все ссылки на объект живут в одном потоке
+struct AtomicRefCount {
+    static void increment(atomic<uint32_t>& count) {
+        count.fetch_add(1, memory_order_relaxed);
+    }
+
+    // true, если ссылка была последней
+    static bool decrement(atomic<uint32_t>& count) {
+        return count.fetch_sub(1, memory_order_acq_rel) == 1;
+    }
+};
+
+struct SingleThreadRefCount {
+    static void increment(atomic<uint32_t>& count) {
+        count.store(count.load(memory_order_relaxed) + 1, memory_order_relaxed);
+    }
+
+    static bool decrement(atomic<uint32_t>& count) {
+        uint32_t left = count.load(memory_order_relaxed) - 1;
+        count.store(left, memory_order_relaxed);
+        return left == 0;
+    }
+};
+
+// Владеющая ссылка на Ingredient со счетчиком внутри самого объекта: одно выделение памяти
+// на объект (без отдельного блока управления, как у shared_ptr), и счетчик лежит рядом с данными.
+// На границах с кодом, который ждет shared_ptr, есть toShared()/fromShared()
+template <class CountPolicy>
+class BasicIngredientRef {
+
+private:
+
+    Ingredient* ptr = nullptr;
+
+    explicit BasicIngredientRef(Ingredient* adopted) : ptr(adopted) {}
+
+    // Удалитель shared_ptr из toShared(): держит ссылку, пока жив shared_ptr
+    struct SharedKeeper {
+        BasicIngredientRef ref;
+
+        void operator()(Ingredient*) { ref.reset(); }
+    };
+
+public:
+
+    BasicIngredientRef() = default;
+
+    template <class... Args>
+    static BasicIngredientRef make(Args&&... args) {
+        Ingredient* created = new Ingredient(forward<Args>(args)...);
+        CountPolicy::increment(created->refCount.value);
+        return BasicIngredientRef(created);
+    }
+
+    BasicIngredientRef(const BasicIngredientRef& other) : ptr(other.ptr) {
+        if (ptr) {
+            CountPolicy::increment(ptr->refCount.value);
+        }
+    }
+
+    BasicIngredientRef(BasicIngredientRef&& other) noexcept : ptr(other.ptr) {
+        other.ptr = nullptr;
+    }
+
+    BasicIngredientRef& operator=(const BasicIngredientRef& other) {
+        BasicIngredientRef copy(other);
+        swap(ptr, copy.ptr);
+        return *this;
+    }
+
+    BasicIngredientRef& operator=(BasicIngredientRef&& other) noexcept {
+        if (this != &other) {
+            reset();
+            ptr = other.ptr;
+            other.ptr = nullptr;
+        }
+        return *this;
+    }
+
+    ~BasicIngredientRef() {
+        reset();
+    }
+
+    void reset() {
+        if (ptr && CountPolicy::decrement(ptr->refCount.value)) {
+            delete ptr;
+        }
+        ptr = nullptr;
+    }
+
+    Ingredient* get() const { return ptr; }
+
+    Ingredient& operator*() const { return *ptr; }
+
+    Ingredient* operator->() const { return ptr; }
+
+    explicit operator bool() const { return ptr != nullptr; }
+
+    uint32_t use_count() const { return ptr ? ptr->refCount.value.load(memory_order_relaxed) : 0; }
+
+    // shared_ptr для кода, который работает с shared_ptr; пока он жив, объект удерживается
+    // этой ссылкой (выделяется только блок управления shared_ptr)
+    shared_ptr<Ingredient> toShared() const {
+        if (!ptr) {
+            return nullptr;
+        }
+        return shared_ptr<Ingredient>(ptr, SharedKeeper{ *this });
+    }
+
+    // Обратное преобразование для shared_ptr, полученного из toShared().
+    // Объект, созданный через make_shared, принадлежит блоку управления shared_ptr,
+    // и интрузивная ссылка на него невозможна - в этом случае invalid_argument
+    static BasicIngredientRef fromShared(const shared_ptr<Ingredient>& shared) {
+        if (!shared) {
+            return BasicIngredientRef();
+        }
+        if (const SharedKeeper* keeper = get_deleter<SharedKeeper>(shared)) {
+            return keeper->ref;
+        }
+        throw invalid_argument("IngredientRef::fromShared: объект создан не через IngredientRef");
+    }
+};
+
+using IngredientRef = BasicIngredientRef<AtomicRefCount>;
+using LocalIngredientRef = BasicIngredientRef<SingleThreadRefCount>;
+
+//  Реестр ингредиентов с отложенным освобождением по эпохам 
+
+// Эпохи (epoch-based reclamation). Читатель на время обращения к общим данным "входит"
+// в текущую эпоху; удаленный писателем объект освобождается, только когда глобальная эпоха
+// ушла на два шага вперед, - к этому моменту ни один читатель, который мог его видеть,
+// уже не работает. Читателю не нужны ни мьютекс, ни счетчик ссылок на объект
+class EpochDomain {
+
+private:
+
+    // Запись потока: 0 - вне чтения, иначе эпоха, в которой поток начал читать
+    struct Record {
+        atomic<uint64_t> epoch{0};
+        atomic<bool> inUse{false};
+        unsigned depth = 0; // Вложенность входов, меняет только поток-владелец
+        Record* next = nullptr;
+    };
+
+    // Освобождает запись при завершении потока
+    struct ThreadSlot {
+        Record* record = nullptr;
+
+        ~ThreadSlot() {
+            if (record) {
+                record->epoch.store(0, memory_order_release);
+                record->inUse.store(false, memory_order_release);
+            }
+        }
+    };
+
+    atomic<uint64_t> globalEpoch{1};
+    atomic<Record*> records{nullptr}; // Записи только добавляются и переиспользуются
+
+    Record* acquireRecord() {
+        for (Record* r = records.load(memory_order_acquire); r; r = r->next) {
+            bool expected = false;
+            if (!r->inUse.load(memory_order_relaxed) && r->inUse.compare_exchange_strong(expected, true)) {
+                return r;
+            }
+        }
+        Record* r = new Record;
+        r->inUse.store(true, memory_order_relaxed);
+        Record* head = records.load(memory_order_relaxed);
+        do {
+            r->next = head;
+        } while (!records.compare_exchange_weak(head, r, memory_order_release, memory_order_relaxed));
+        return r;
+    }
+
+    Record& local() {
+        thread_local ThreadSlot slot;
+        if (!slot.record) {
+            slot.record = acquireRecord();
+        }
+        return *slot.record;
+    }
+
+public:
+
+    static EpochDomain& instance() {
+        static EpochDomain domain;
+        return domain;
+    }
+
+    // Записи живут до конца программы: к этому моменту потоки, которые их держали, завершены
+    ~EpochDomain() {
+        Record* r = records.load(memory_order_acquire);
+        while (r) {
+            Record* next = r->next;
+            delete r;
+            r = next;
+        }
+    }
+
+    void enter() {
+        Record& r = local();
+        if (r.depth++ == 0) {
+            r.epoch.store(globalEpoch.load(memory_order_relaxed), memory_order_relaxed);
+            atomic_thread_fence(memory_order_seq_cst); // Эпоха видна писателям раньше, чем мы читаем данные
+        }
+    }
+
+    void leave() {
+        Record& r = local();
+        if (--r.depth == 0) {
+            r.epoch.store(0, memory_order_release);
+        }
+    }
+
+    uint64_t current() const {
+        return globalEpoch.load(memory_order_acquire);
+    }
+
+    // Сдвигает эпоху, если все читающие потоки уже в текущей; возвращает эпоху после попытки
+    uint64_t tryAdvance() {
+        uint64_t epoch = globalEpoch.load(memory_order_acquire);
+        atomic_thread_fence(memory_order_seq_cst);
+        for (Record* r = records.load(memory_order_acquire); r; r = r->next) {
+            uint64_t seen = r->epoch.load(memory_order_acquire);
+            if (seen != 0 && seen != epoch) {
+                return epoch;
+            }
+        }
+        globalEpoch.compare_exchange_strong(epoch, epoch + 1);
+        return globalEpoch.load(memory_order_acquire);
+    }
+};
+
+// Область чтения: пока объект жив, найденные в реестре ингредиенты не будут освобождены
+class EpochGuard {
+
+public:
+
+    EpochGuard() { EpochDomain::instance().enter(); }
+
+    ~EpochGuard() { EpochDomain::instance().leave(); }
+
+    EpochGuard(const EpochGuard&) = delete;
+    EpochGuard& operator=(const EpochGuard&) = delete;
+};
+
+// Реестр ингредиентов по имени. Корзин фиксированное число, в каждой - цепочка неизменяемых
+// узлов. Чтение идет без блокировок: загрузка головы цепочки и проход по ней внутри EpochGuard.
+// Писатели упорядочены мьютексом: добавление ставит новый узел в голову, удаление собирает
+// копию части цепочки перед удаляемым узлом и публикует ее одной записью. Старые узлы и
+// удаленные ингредиенты уходят в список ожидания и освобождаются по эпохам
+class IngredientRegistry {
+
+private:
+
+    struct Node {
+        size_t hash;
+        string name;
+        Ingredient* ingredient; // Общий для узла и его копий
+        Node* next;
+    };
+
+    struct Retired {
+        uint64_t epoch;
+        Node* node;
+        Ingredient* ingredient; // nullptr для копий-предшественников
+    };
+
+    unique_ptr<atomic<Node*>[]> buckets;
+    size_t mask;
+    mutex writeMutex;
+    vector<Retired> limbo; // Под writeMutex
+    atomic<size_t> count{0};
+    atomic<size_t> pending{0};
+    uint64_t reclaimed = 0;
+
+    atomic<Node*>& bucketFor(size_t hash) const {
+        return buckets[hash & mask];
+    }
+
+    void retireLocked(Node* node, Ingredient* ingredient) {
+        limbo.push_back({ EpochDomain::instance().current(), node, ingredient });
+        pending.store(limbo.size(), memory_order_relaxed);
+        if (limbo.size() % 64 == 0) {
+            collectLocked();
+        }
+    }
+
+    void collectLocked() {
+        uint64_t epoch = EpochDomain::instance().tryAdvance();
+        size_t kept = 0;
+        for (Retired& r : limbo) {
+            if (r.epoch + 2 <= epoch) {
+                delete r.ingredient;
+                delete r.node;
+                ++reclaimed;
+            }
+            else {
+                limbo[kept++] = r;
+            }
+        }
+        limbo.resize(kept);
+        pending.store(kept, memory_order_relaxed);
+    }
+
+public:
+
+    // Число корзин округляется вверх до степени двойки
+    explicit IngredientRegistry(size_t bucketCount = 1024) {
+        size_t size = 1;
+        while (size < bucketCount) {
+            size *= 2;
+        }
+        buckets.reset(new atomic<Node*>[size]);
+        for (size_t i = 0; i < size; ++i) {
+            buckets[i].store(nullptr, memory_order_relaxed);
+        }
+        mask = size - 1;
+    }
+
+    IngredientRegistry(const IngredientRegistry&) = delete;
+    IngredientRegistry& operator=(const IngredientRegistry&) = delete;
+
+    // Читателей к этому моменту быть не должно
+    ~IngredientRegistry() {
+        for (size_t i = 0; i <= mask; ++i) {
+            Node* node = buckets[i].load(memory_order_relaxed);
+            while (node) {
+                Node* next = node->next;
+                delete node->ingredient;
+                delete node;
+                node = next;
+            }
+        }
+        for (Retired& r : limbo) {
+            delete r.ingredient;
+            delete r.node;
+        }
+    }
+
+    // Поиск без блокировок; указатель действителен, пока жив guard
+    const Ingredient* find(string_view name, const EpochGuard&) const {
+        size_t hash = std::hash<string_view>()(name);
+        for (Node* node = bucketFor(hash).load(memory_order_acquire); node; node = node->next) {
+            if (node->hash == hash && node->name == name) {
+                return node->ingredient;
+            }
+        }
+        return nullptr;
+    }
+
+    // Поиск и вызов f(const Ingredient&) внутри собственной области чтения
+    template <class F>
+    bool visit(string_view name, F&& f) const {
+        EpochGuard guard;
+        if (const Ingredient* ingredient = find(name, guard)) {
+            f(*ingredient);
+            return true;
+        }
+        return false;
+    }
+
+    // Добавляет ингредиент; false, если имя уже занято
+    bool add(const string& name) {
+        lock_guard<mutex> lock(writeMutex);
+        size_t hash = std::hash<string_view>()(name);
+        atomic<Node*>& bucket = bucketFor(hash);
+        Node* head = bucket.load(memory_order_relaxed);
+        for (Node* node = head; node; node = node->next) {
+            if (node->hash == hash && node->name == name) {
+                return false;
+            }
+        }
+        bucket.store(new Node{ hash, name, new Ingredient(name), head }, memory_order_release);
+        count.fetch_add(1, memory_order_relaxed);
+        return true;
+    }
+
+    // Удаляет ингредиент; сам объект освобождается позже, когда его не сможет видеть ни один читатель
+    bool remove(string_view name) {
+        lock_guard<mutex> lock(writeMutex);
+        size_t hash = std::hash<string_view>()(name);
+        atomic<Node*>& bucket = bucketFor(hash);
+        Node* head = bucket.load(memory_order_relaxed);
+        Node* target = head;
+        while (target && !(target->hash == hash && target->name == name)) {
+            target = target->next;
+        }
+        if (!target) {
+            return false;
+        }
+
+        // Копия узлов перед удаляемым, присоединенная к его хвосту
+        Node* rebuilt = target->next;
+        vector<Node*> prefix;
+        for (Node* node = head; node != target; node = node->next) {
+            prefix.push_back(node);
+        }
+        for (size_t i = prefix.size(); i-- > 0;) {
+            rebuilt = new Node{ prefix[i]->hash, prefix[i]->name, prefix[i]->ingredient, rebuilt };
+        }
+        bucket.store(rebuilt, memory_order_release);
+        count.fetch_sub(1, memory_order_relaxed);
+
+        for (Node* node : prefix) {
+            retireLocked(node, nullptr);
+        }
+        retireLocked(target, target->ingredient);
+        return true;
+    }
+
+    // Освобождает все, что уже безопасно освободить
+    void collect() {
+        lock_guard<mutex> lock(writeMutex);
+        collectLocked();
+    }
+
+    size_t size() const { return count.load(memory_order_relaxed); }
+
+    // Удаленных узлов и ингредиентов, ждущих освобождения
+    size_t pendingReclaim() const { return pending.load(memory_order_relaxed); }
+};
+
 //  Функции, работающие с умными указателями 
 
 // Принимает unique_ptr по значению (требует move) - ЗАБИРАЕТ владение
@@ -95,11 +562,423 @@ shared_ptr<Ingredient> buy_shared_ingredient(const string& name) {
     return ptr;
 }
 
+//  Замеры 
+
+// Приемники для замера передачи по значению и по ссылке; noinline, чтобы вызов не растворился
+template <class Handle>
+[[gnu::noinline]] size_t take_by_value(Handle handle) {
+    bench::doNotOptimize(handle.get());
+    return handle ? 1 : 0;
+}
+
+template <class Handle>
+[[gnu::noinline]] size_t observe_by_ref(const Handle& handle) {
+    bench::doNotOptimize(handle.get());
+    return handle ? 1 : 0;
+}
+
+// Замер реестра: N читателей и M писателей в течение заданного времени.
+// Для сравнения - unordered_map под shared_mutex. Возвращает false при ошибке чтения
+struct RegistryRunResult {
+    uint64_t reads = 0;
+    uint64_t writes = 0;
+    uint64_t errors = 0;
+    uint64_t elapsedNs = 0;
+};
+
+RegistryRunResult runRegistryLoad(IngredientRegistry& registry, const vector<string>& names, size_t readers, size_t writers, uint64_t durationMs) {
+
+    atomic<bool> stop{false};
+    atomic<uint64_t> reads{0}, writes{0}, errors{0};
+    vector<thread> threads;
+
+    for (size_t t = 0; t < readers; ++t) {
+        threads.emplace_back([&, t] {
+            uint64_t seed = 0x9E3779B97F4A7C15ull * (t + 1), done = 0, bad = 0;
+            while (!stop.load(memory_order_relaxed)) {
+                for (int i = 0; i < 256; ++i) {
+                    seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+                    const string& name = names[(seed >> 33) % names.size()];
+                    EpochGuard guard;
+                    if (const Ingredient* ingredient = registry.find(name, guard)) {
+                        // Изредка полная проверка: объект не освобожден и принадлежит имени
+                        if ((done & 63) == 0 && ingredient->getName() != name) {
+                            ++bad;
+                        }
+                    }
+                    ++done;
+                }
+            }
+            reads += done;
+            errors += bad;
+        });
+    }
+
+    for (size_t t = 0; t < writers; ++t) {
+        threads.emplace_back([&, t] {
+            uint64_t seed = 0xC2B2AE3D27D4EB4Full * (t + 1), done = 0;
+            while (!stop.load(memory_order_relaxed)) {
+                seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+                const string& name = names[(seed >> 33) % names.size()];
+                if (!registry.remove(name)) {
+                    registry.add(name);
+                }
+                ++done;
+            }
+            writes += done;
+        });
+    }
+
+    bench::Stopwatch timer;
+    this_thread::sleep_for(chrono::milliseconds(durationMs));
+    stop.store(true);
+    for (thread& t : threads) {
+        t.join();
+    }
+
+    RegistryRunResult result;
+    result.reads = reads.load();
+    result.writes = writes.load();
+    result.errors = errors.load();
+    result.elapsedNs = timer.elapsedNs();
+    return result;
+}
+
+// То же для unordered_map под shared_mutex: читатели берут разделяемую блокировку
+RegistryRunResult runLockedMapLoad(const vector<string>& names, size_t readers, uint64_t durationMs) {
+
+    unordered_map<string, unique_ptr<Ingredient>> map;
+    shared_mutex mapMutex;
+    for (size_t i = 0; i < names.size(); i += 2) {
+        map.emplace(names[i], make_unique<Ingredient>(names[i]));
+    }
+
+    atomic<bool> stop{false};
+    atomic<uint64_t> reads{0}, writes{0};
+    vector<thread> threads;
+
+    for (size_t t = 0; t < readers; ++t) {
+        threads.emplace_back([&, t] {
+            uint64_t seed = 0x9E3779B97F4A7C15ull * (t + 1), done = 0;
+            while (!stop.load(memory_order_relaxed)) {
+                for (int i = 0; i < 256; ++i) {
+                    seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+                    const string& name = names[(seed >> 33) % names.size()];
+                    shared_lock<shared_mutex> lock(mapMutex);
+                    auto found = map.find(name);
+                    bench::doNotOptimize(found == map.end() ? nullptr : found->second.get());
+                    ++done;
+                }
+            }
+            reads += done;
+        });
+    }
+
+    threads.emplace_back([&] {
+        uint64_t seed = 0xC2B2AE3D27D4EB4Full, done = 0;
+        while (!stop.load(memory_order_relaxed)) {
+            seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+            const string& name = names[(seed >> 33) % names.size()];
+            {
+                unique_lock<shared_mutex> lock(mapMutex);
+                if (map.erase(name) == 0) {
+                    map.emplace(name, make_unique<Ingredient>(name));
+                }
+            }
+            ++done;
+        }
+        writes += done;
+    });
+
+    bench::Stopwatch timer;
+    this_thread::sleep_for(chrono::milliseconds(durationMs));
+    stop.store(true);
+    for (thread& t : threads) {
+        t.join();
+    }
+
+    RegistryRunResult result;
+    result.reads = reads.load();
+    result.writes = writes.load();
+    result.elapsedNs = timer.elapsedNs();
+    return result;
+}
+
+// Program5 bench registry [читателей] [писателей] [мс]
+int benchmarkRegistry(int argc, char* argv[]) {
+
+    lifecycle::ScopedMute mute;
+
+    size_t readers = 4;
+    size_t writers = 2;
+    uint64_t durationMs = 1000;
+    if (!bench::countArg(argc, argv, 3, readers, 0) || !bench::countArg(argc, argv, 4, writers, 0)
+        || !bench::countArg(argc, argv, 5, durationMs)) {
+        return 1;
+    }
+
+    vector<string> names;
+    for (int i = 0; i < 4096; ++i) {
+        names.push_back("Ингредиент #" + to_string(i));
+    }
+
+    bool ok = true;
+    {
+        IngredientRegistry registry;
+        for (size_t i = 0; i < names.size(); i += 2) {
+            registry.add(names[i]);
+        }
+
+        RegistryRunResult stress = runRegistryLoad(registry, names, readers, writers, durationMs);
+        registry.collect();
+        registry.collect();
+        registry.collect(); // Без читателей эпоха сдвигается каждый раз, и ожидающее освобождается
+
+        ok = stress.errors == 0 && registry.pendingReclaim() == 0;
+        cout << "Нагрузка на IngredientRegistry: читателей " << readers << ", писателей " << writers << ", " << stress.elapsedNs / 1000000 << " мс" << endl;
+        cout << "  чтений: " << stress.reads << ", изменений: " << stress.writes << ", ошибок чтения: " << stress.errors
+            << ", в реестре: " << registry.size() << ", ждут освобождения: " << registry.pendingReclaim() << endl;
+    }
+
+    const uint64_t scalingMs = durationMs / 5 + 1;
+    cout << "Масштабирование (1 писатель, " << scalingMs << " мс на точку), млн чтений/с:" << endl;
+    cout << "  потоков  эпохи  shared_mutex" << endl;
+    for (size_t threads : { 1, 2, 4, 8, 16, 32 }) {
+        IngredientRegistry registry;
+        for (size_t i = 0; i < names.size(); i += 2) {
+            registry.add(names[i]);
+        }
+        RegistryRunResult lockFree = runRegistryLoad(registry, names, threads, 1, scalingMs);
+        RegistryRunResult locked = runLockedMapLoad(names, threads, scalingMs);
+        ok = ok && lockFree.errors == 0;
+        cout << "  " << threads << "\t   " << lockFree.reads * 1000.0 / lockFree.elapsedNs << "\t " << locked.reads * 1000.0 / locked.elapsedNs << endl;
+    }
+
+    cout << "Проверка " << (ok ? "пройдена" : "НЕ пройдена") << " (аппаратных потоков: " << thread::hardware_concurrency() << ")" << endl;
+
+    return ok ? 0 : 1;
+}
+
+// Замер: shared_ptr против IngredientRef (атомарного и однопоточного)
+int benchmarkIngredientRef(int argc, char* argv[]) {
+
+    lifecycle::ScopedMute mute;
+
+    size_t n = 10000000;
+    if (!bench::countArg(argc, argv, 3, n)) {
+        return 1;
+    }
+    const size_t storm = 1000; // Копий в одном "шторме"
+
+    auto run = [&](const char* label, auto handle) {
+        using Handle = decltype(handle);
+        size_t sink = 0;
+
+        bench::Stopwatch timer;
+        for (size_t i = 0; i < n; ++i) {
+            sink += take_by_value<Handle>(handle);
+        }
+        uint64_t byValueNs = timer.elapsedNs();
+
+        timer.restart();
+        for (size_t i = 0; i < n; ++i) {
+            sink += observe_by_ref<Handle>(handle);
+        }
+        uint64_t byRefNs = timer.elapsedNs();
+
+        vector<Handle> copies;
+        copies.reserve(storm);
+        timer.restart();
+        for (size_t round = 0; round < n / storm; ++round) {
+            for (size_t i = 0; i < storm; ++i) {
+                copies.push_back(handle);
+            }
+            copies.clear();
+        }
+        uint64_t stormNs = timer.elapsedNs();
+        bench::doNotOptimize(sink);
+
+        cout << "  " << label << ": по значению " << static_cast<double>(byValueNs) / n << " нс, по ссылке "
+            << static_cast<double>(byRefNs) / n << " нс, шторм копий " << static_cast<double>(stormNs) / n << " нс/копию" << endl;
+    };
+
+    cout << "Передача владеющей ссылки на Ingredient, операций: " << n << endl;
+
+    // Создание: сколько выделений памяти и байт требует один объект
+    auto creation = [&](const char* label, auto make) {
+        alloc_hooks::AllocScope allocations;
+        bench::Stopwatch timer;
+        for (size_t i = 0; i < n / 10; ++i) {
+            auto handle = make();
+            bench::doNotOptimize(handle.get());
+        }
+        alloc_hooks::AllocStats d = allocations.delta();
+        cout << "  создание, " << label << ": " << static_cast<double>(timer.elapsedNs()) / (n / 10) << " нс, выделений "
+            << static_cast<double>(d.allocations) / (n / 10) << ", байт " << static_cast<double>(d.bytes) / (n / 10) << " на объект" << endl;
+    };
+    creation("make_shared", [] { return make_shared<Ingredient>("Соль"); });
+    creation("shared_ptr(new)", [] { return shared_ptr<Ingredient>(new Ingredient("Соль")); });
+    creation("IngredientRef::make", [] { return IngredientRef::make("Соль"); });
+
+    // libstdc++ не делает атомарных операций в shared_ptr, пока в программе один поток,
+    // поэтому замер повторяется после запуска второго потока
+    for (int pass = 0; pass < 2; ++pass) {
+        if (pass == 1) {
+            thread([] {}).join();
+            cout << "После запуска второго потока:" << endl;
+        }
+        run("shared_ptr", make_shared<Ingredient>("Соль"));
+        run("IngredientRef (атомарный)", IngredientRef::make("Соль"));
+        run("LocalIngredientRef (однопоточный)", LocalIngredientRef::make("Соль"));
+    }
+
+    // Граница с кодом на shared_ptr: туда и обратно без нового объекта
+    IngredientRef salt = IngredientRef::make("Соль");
+    shared_ptr<Ingredient> shared = salt.toShared();
+    IngredientRef back = IngredientRef::fromShared(shared);
+    bool roundTrip = back.get() == salt.get() && back.use_count() == 3;
+    shared.reset();
+    roundTrip = roundTrip && salt.use_count() == 2;
+
+    bool rejected = false;
+    try {
+        IngredientRef::fromShared(make_shared<Ingredient>("Перец"));
+    }
+    catch (const invalid_argument&) {
+        rejected = true;
+    }
+
+    cout << "  toShared/fromShared: " << (roundTrip && rejected ? "работают" : "ОШИБКА") << endl;
+
+    return roundTrip && rejected ? 0 : 1;
+}
+
+// Замер хвостовых задержек: цикл запросов, каждый создает и выбрасывает несколько ингредиентов.
+// Деструкторы (освобождение строк и трассировка) выполняются сразу, фоновым потоком или в тихих точках
+int benchmarkDeferred(int argc, char* argv[]) {
+
+    size_t requests = 200000;
+    if (!bench::countArg(argc, argv, 3, requests)) {
+        return 1;
+    }
+    const size_t perRequest = 16;
+    const size_t quiescentEvery = 64; // Тихая точка - после каждых 64 запросов, вне замера
+
+    vector<string> names;
+    for (int i = 0; i < 256; ++i) {
+        names.push_back("Ингредиент для запроса #" + to_string(i)); // Длиннее встроенного буфера строки
+    }
+
+    struct Row {
+        string label;
+        vector<uint64_t> latencies;
+        uint64_t wallNs;
+    };
+    vector<Row> rows;
+    deferred::Reclaimer& reclaimer = deferred::Reclaimer::instance();
+
+    auto run = [&](const string& label, auto holderTag, bool quiescentPoints) {
+        using Holder = typename decltype(holderTag)::type;
+        Row row{ label, vector<uint64_t>(requests), 0 };
+        bench::MuteStream quiet(cout); // Трассировка остается включенной, но печатает в никуда
+
+        bench::Stopwatch wall;
+        for (size_t r = 0; r < requests; ++r) {
+            bench::Stopwatch timer;
+            {
+                vector<Holder> batch;
+                batch.reserve(perRequest);
+                size_t work = 0;
+                for (size_t i = 0; i < perRequest; ++i) {
+                    batch.emplace_back(new Ingredient(names[(r * 7 + i) % names.size()]));
+                    work += batch.back()->getName().size();
+                }
+                bench::doNotOptimize(work);
+            }
+            row.latencies[r] = timer.elapsedNs();
+            if (quiescentPoints && r % quiescentEvery == quiescentEvery - 1) {
+                deferred::quiescent();
+            }
+        }
+        deferred::quiescent();
+        while (reclaimer.destroyed() != reclaimer.retired()) {
+            this_thread::yield(); // Фоновый поток может еще доуничтожать последнюю пачку
+        }
+        row.wallNs = wall.elapsedNs();
+        rows.push_back(move(row));
+    };
+
+    struct InlineTag { using type = unique_ptr<Ingredient>; };
+    struct DeferredTag { using type = unique_ptr<Ingredient, deferred::Delete<Ingredient>>; };
+
+    run("сразу (unique_ptr)", InlineTag(), false);
+
+    reclaimer.configure(deferred::Mode::Quiescent, deferred::Order::Fifo, 256);
+    run("отложенно, тихие точки, FIFO", DeferredTag(), true);
+
+    reclaimer.configure(deferred::Mode::Quiescent, deferred::Order::Lifo, 256);
+    run("отложенно, тихие точки, LIFO", DeferredTag(), true);
+
+    reclaimer.configure(deferred::Mode::Background, deferred::Order::Fifo, 256);
+    run("отложенно, фоновый поток", DeferredTag(), false);
+
+    cout << "Запросов: " << requests << " по " << perRequest << " ингредиентов, задержка запроса в мкс:" << endl;
+    double inlineP99 = 0;
+    for (Row& row : rows) {
+        sort(row.latencies.begin(), row.latencies.end());
+        auto percentile = [&row](double p) {
+            size_t index = static_cast<size_t>(p * (row.latencies.size() - 1));
+            return row.latencies[index] / 1000.0;
+        };
+        cout << "  " << row.label << ": p50 " << percentile(0.5) << ", p99 " << percentile(0.99) << ", p99.9 " << percentile(0.999)
+            << ", макс. " << row.latencies.back() / 1000.0 << "; всего с уничтожением " << row.wallNs / 1000000 << " мс" << endl;
+        if (&row == &rows.front()) {
+            inlineP99 = percentile(0.99);
+        }
+        else if (percentile(0.99) > inlineP99) {
+            // Фоновому потоку нужно свободное ядро, иначе уничтожение делит ядро с запросами
+            cerr << "  ВНИМАНИЕ: '" << row.label << "' хуже уничтожения сразу по p99 (" << percentile(0.99) << " > " << inlineP99
+                << " мкс), ядер: " << thread::hardware_concurrency() << endl;
+        }
+    }
+
+    bool ok = reclaimer.retired() == reclaimer.destroyed();
+    cout << "  передано на отложенное уничтожение: " << reclaimer.retired() << ", уничтожено: " << reclaimer.destroyed()
+        << ", пачек: " << reclaimer.batchesDestroyed() << endl;
+
+    return ok ? 0 : 1;
+}
+
+// Запуск замеров из командной строки: Program5 bench <имя> [параметры]
+int runBenchmark(int argc, char* argv[]) {
+
+    string name = argc > 2 ? argv[2] : "";
+
+    if (name == "refs") {
+        return benchmarkIngredientRef(argc, argv);
+    }
 
-int main() {
+    if (name == "registry") {
+        return benchmarkRegistry(argc, argv);
+    }
+
+    if (name == "deferred") {
+        return benchmarkDeferred(argc, argv);
+    }
+
+    cout << "Неизвестный замер '" << name << "'. Доступные: refs, registry, deferred" << endl;
+
+    return 1;
+}
+
+int main(int argc, char* argv[]) {
     // Установка русской локали
     setlocale(LC_ALL, "RU");
 
+    if (argc > 1 && string(argv[1]) == "bench") {
+        return runBenchmark(argc, argv);
+    }
+
     cout << "Демонстрация unique_ptr" << endl << endl; 
 
     cout << "Создание unique_ptr" << endl; 